@@ -1,10 +1,11 @@
 #pragma once
 
 #include "main.hpp"
-#include "Drawing.hpp"
 #include "Utility/SimpleTypes.hpp"
 #include "Utility/RecyclingList.hpp"
+#include "Utility/PositionSet.hpp"
 
+#include <span>
 #include <array>
 #include <tuple>
 #include <unordered_map>
@@ -42,7 +43,11 @@ public:
 	template<class T>
 	RecyclingList<T>& get_list() { return lists->get<T>(); }
 
-	[[nodiscard]] Engine& get_engine() const { return *engine; }
+	[[nodiscard]] Engine& get_engine() const
+	{
+		assert(engine != nullptr);
+		return *engine;
+	}
 
 	[[nodiscard]] TileTag get(Int2 position) const;
 
@@ -52,12 +57,47 @@ public:
 
 	void set(Int2 position, TileTag tile);
 
+	/**
+	 * Gives a new wire its own component, which is what the tiles of the wire refer to instead of its Index.
+	 */
+	void register_wire(Index index);
+
+	/**
+	 * Joins the component of a wire into the component of target, so the tiles of the wire resolve to target without being set again.
+	 */
+	void merge_wire(Index index, Index target);
+
 	void erase(Bounds bounds);
+
+	/**
+	 * Copies the tiles within bounds, along with only the wires, bridges and gates they refer to under new dense indices.
+	 * The copy has no engine, so it can be drawn and pasted from but not edited, simulated or serialized.
+	 */
 	Layer copy(Bounds bounds) const;
 
+	/**
+	 * Inserts the tiles of source within bounds into the empty tiles of this layer, rotated, once at each of the positions,
+	 * which are the minimum corners of the rotated copies. The wires of all copies are connected in a single pass.
+	 */
+	void paste(const Layer& source, Bounds bounds, TileRotation rotation, std::span<const Int2> positions);
+
+	/**
+	 * Compacts the merged components once they outnumber the wires enough to be worth a pass over every chunk.
+	 * Edits never compact on their own, so this is called after a batch of edits, where such a pause is expected.
+	 */
+	void compact();
+
+	/**
+	 * Reads a layer from a file of any version from OldestFileVersion to FileVersion.
+	 */
+	void read(BinaryReader& reader, uint32_t version);
+
 	friend BinaryWriter& operator<<(BinaryWriter& writer, const Layer& layer);
 	friend BinaryReader& operator>>(BinaryReader& reader, Layer& layer);
 
+	static constexpr uint32_t FileVersion = 4;       //The version of the files written, which precedes the layer in a file
+	static constexpr uint32_t OldestFileVersion = 3; //Version 3 only differs in how the engine stores states
+
 private:
 	class Chunk;
 
@@ -66,9 +106,37 @@ private:
 
 	static Bounds to_chunk_space(Bounds bounds); //From world / tile space to chunk space
 
+	/**
+	 * Follows the parents of a component to its root and returns the wire of that root.
+	 */
+	[[nodiscard]] Index find_wire(uint32_t component) const;
+
+	/**
+	 * Points every wire tile directly at its wire, so the merged components can be dropped.
+	 */
+	void compact_components();
+
+	/**
+	 * Resets the components so that the component of every wire is its Index, which is what the wire tiles must already refer to.
+	 */
+	void reset_components();
+
+	/**
+	 * Adds every gate to the gates of its connected wires, which are not serialized.
+	 */
+	void connect_gates();
+
 	std::unordered_map<Int2, std::unique_ptr<Chunk>> chunks;
 	std::unique_ptr<ListsType> lists;
 	std::unique_ptr<Engine> engine;
+
+	//Wire tiles store a component instead of a wire Index, and merged components form a union-find forest
+	//The root of each wire is the longest of the merged wires, so the trees stay shallow until they are compacted
+	std::vector<uint32_t> component_parents;
+	std::vector<Index> component_wires; //The wire of each root component
+	std::vector<uint32_t> wire_components; //The root component of each wire Index
+
+	static constexpr size_t CompactionThreshold = 1024; //Components are only compacted by compact once there are this many
 };
 
 class Layer::Chunk
@@ -86,9 +154,16 @@ public:
 
 	bool set(Int2 position, TileTag tile);
 
+	void mark_vertices_dirty() { vertices_dirty = true; }
+
+	/**
+	 * Replaces the component of every wire tile with its wire Index.
+	 */
+	void resolve_wires(const Layer& layer);
+
 	void update_draw_buffer(DrawContext& context, const Layer& layer);
 
-	void write(BinaryWriter& writer) const;
+	void write(BinaryWriter& writer, const Layer& layer) const;
 	void read(BinaryReader& reader);
 
 	static Int2 get_chunk_position(Int2 position) { return { position.x >> Chunk::SizeLog2, position.y >> Chunk::SizeLog2 }; }
@@ -100,6 +175,7 @@ public:
 	static constexpr uint32_t SizeLog2 = 5;
 	static constexpr uint32_t Size = 1u << SizeLog2;
 	static constexpr uint32_t Size2 = Size * Size;
+	static_assert(Size == PositionSet::Size);
 
 private:
 	[[nodiscard]] TileTag get(size_t tile_index) const;
@@ -108,8 +184,8 @@ private:
 	{
 		Int2 local_position = get_local_position(position);
 
-		assert(0 <= local_position.x && local_position.x < Size);
-		assert(0 <= local_position.y && local_position.y < Size);
+		assert(0 <= local_position.x && local_position.x < static_cast<int32_t>(Size));
+		assert(0 <= local_position.y && local_position.y < static_cast<int32_t>(Size));
 		return local_position.y * Size + local_position.x;
 	}
 
@@ -118,8 +194,41 @@ private:
 	std::unique_ptr<std::array<uint32_t, Size2>> tile_indices;
 
 	bool vertices_dirty = false;
-	VertexBuffer vertex_buffer_quad;
-	VertexBuffer vertex_buffer_wire;
+
+	//Held through shared pointers so that chunks can be created and destroyed without referencing any GL functions
+	std::shared_ptr<VertexBuffer> vertex_buffer_quad;
+	std::shared_ptr<VertexBuffer> vertex_buffer_wire;
 };
 
+template<class Action>
+void Layer::for_each_chunk(Action action, Bounds bounds) const
+{
+	Bounds chunk_bounds = to_chunk_space(bounds);
+
+	if (chunks.size() < static_cast<size_t>(chunk_bounds.size().product()))
+	{
+		//Manual while loop to support removal of chunks during iteration
+		auto iterator = chunks.begin();
+
+		while (iterator != chunks.end())
+		{
+			Int2 chunk_position = iterator->first;
+			Chunk* chunk = iterator->second.get();
+
+			++iterator;
+			if (chunk_bounds.contains(chunk_position)) action(*chunk);
+		}
+	}
+	else
+	{
+		//Loop through all chunk positions
+		for (Int2 position : chunk_bounds)
+		{
+			auto iterator = chunks.find(position);
+			if (iterator == chunks.end()) continue;
+			action(*iterator->second);
+		}
+	}
+}
+
 }
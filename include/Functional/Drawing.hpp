@@ -30,12 +30,23 @@ public:
 		return *this;
 	}
 
+	[[nodiscard]] size_t get_size() const { return size; }
+
 	template<class T>
 	void update(const T* data, size_t count)
 	{
 		update_impl(reinterpret_cast<const void*>(data), count * sizeof(T));
 	}
 
+	/**
+	 * Overwrites count elements starting at element offset without reallocating, so the range must be within the current data.
+	 */
+	template<class T>
+	void update_range(const T* data, size_t offset, size_t count)
+	{
+		update_range_impl(reinterpret_cast<const void*>(data), offset * sizeof(T), count * sizeof(T));
+	}
+
 	template<class T>
 	void set_attribute(uint32_t attribute, size_t stride, size_t offset) const;
 
@@ -67,6 +78,7 @@ private:
 	}
 
 	void update_impl(const void* data, size_t new_size);
+	void update_range_impl(const void* data, size_t offset, size_t range_size);
 
 	void set_attribute_impl(uint32_t attribute, uint32_t attribute_size, GLenum attribute_type,
 	                        bool integer, size_t stride, size_t offset) const;
@@ -172,7 +184,28 @@ public:
 
 	void set_rotation(TileRotation new_rotation);
 	void set_view(Float2 center, Float2 extend);
+
+	/**
+	 * Sets whether wires are drawn unpowered without reading the wire states and slots, which is needed for a layer with
+	 * no engine such as the clipboard, because its wire indices do not refer to the states of the simulated layer.
+	 */
+	void set_wires_unpowered(bool new_wires_unpowered);
+	/**
+	 * Sets the wire states from the raw states of Engine::get_states, which are repacked with two bits per wire for the shader.
+	 */
 	void set_wire_states(const void* data, size_t size);
+	void set_wire_slots(const void* data, size_t size);
+
+	/**
+	 * Overwrites size bytes of the wire states starting at byte offset, which must be within the states from the last set_wire_states.
+	 * Both offset and size must cover whole pairs of powered and strong words.
+	 */
+	void update_wire_states(const void* data, size_t offset, size_t size);
+
+	/**
+	 * Returns the number of bytes uploaded to wire states or slots since the last call.
+	 */
+	size_t take_uploaded_size();
 
 	void clip(Float2 min_position, Float2 max_position) const;
 	void draw(bool quad, const VertexBuffer& buffer) const;
@@ -207,9 +240,13 @@ private:
 	TileRotation rotation;
 	Float2 scale;
 	Float2 origin;
+	bool wires_unpowered = false;
 	mutable bool shader_dirty = false;
 
 	DataBuffer wire_states_buffer;
+	DataBuffer wire_slots_buffer;
+	std::vector<uint64_t> packed_states;
+	size_t uploaded_size = 0;
 };
 
 } // rw
@@ -4,6 +4,7 @@
 #include "Utility/SimpleTypes.hpp"
 
 #include <span>
+#include <unordered_map>
 
 namespace rw
 {
@@ -11,27 +12,266 @@ namespace rw
 class Engine
 {
 public:
+	enum class Mode : uint8_t
+	{
+		Sweep,   //Evaluates every gate on every tick
+		Event,   //Only evaluates gates with inputs that changed during the previous tick
+		Parallel, //Evaluates every gate on every tick, partitioned across multiple threads
+		Batch     //Evaluates every gate on every tick for 64 independent lanes of states at once
+	};
+
+	[[nodiscard]] Mode get_mode() const { return mode; }
+
+	void set_mode(Mode new_mode);
+
+	/**
+	 * The number of threads used by Mode::Parallel, including the thread calling tick.
+	 */
+	[[nodiscard]] uint32_t get_thread_count() const { return thread_count; }
+
+	void set_thread_count(uint32_t new_count);
+
+	static uint32_t get_default_thread_count();
+
+	/**
+	 * Whether Mode::Sweep and Mode::Parallel evaluate the gates with AVX2 when the processor supports it, which is the default.
+	 * Otherwise the scalar kernel is used, which is only useful for comparing the two kernels.
+	 */
+	[[nodiscard]] bool get_vectorized() const { return vectorized; }
+
+	void set_vectorized(bool enabled) { vectorized = enabled; }
+
 	void register_wire(Index index);
 
+	/**
+	 * Releases the state slot of a wire. Aliases of the wire must be registered again before they are used.
+	 */
+	void unregister_wire(Index index);
+
+	/**
+	 * Releases the state slot of a wire and redirects it to share the state slot of target, so gates
+	 * connected to either wire read and write the same state. The alias lasts until the wire is registered again.
+	 */
+	void merge_wire(Index index, Index target);
+
 	void register_gate(Index index, Index output, bool transistor, const std::span<Index>& inputs);
 
+	/**
+	 * Removes a gate, which does nothing for a gate without output read from a file, since those are not stored.
+	 */
 	void unregister_gate(Index index);
 
 	void toggle_wire_strong_powered(Index index);
 
+	/**
+	 * Sets whether a wire is strong powered in each of the 64 lanes of Mode::Batch, where bit i is for lane i.
+	 */
+	void set_strong_lanes(Index index, uint64_t strong);
+
+	/**
+	 * Gets the states of a wire in each of the 64 lanes of Mode::Batch, where bit i of powered and strong are the bits of get_state for lane i.
+	 * Outside of Mode::Batch, get_state and get_states return the states of lane 0.
+	 */
+	void get_lanes(Index index, uint64_t& powered, uint64_t& strong) const;
+
 	void tick(uint32_t count = 1);
 
+	/**
+	 * Ticks until a tick no longer changes any state, or until max_count ticks are performed.
+	 * @return The number of ticks performed, including the final tick that confirmed the states are stable.
+	 */
+	uint32_t settle(uint32_t max_count);
+
+	/**
+	 * Whether the last tick did not change any state.
+	 */
+	[[nodiscard]] bool is_stable() const { return changed_words == 0; }
+
+	/**
+	 * An upper bound of the number of state words changed by the last tick, which is zero only if nothing changed.
+	 */
+	[[nodiscard]] size_t get_changed_words() const { return changed_words; }
+
+	[[nodiscard]] bool get_period_detection() const { return period_detection; }
+
+	/**
+	 * Enables hashing the states on every tick to detect when they start repeating, so whole periods can be skipped.
+	 */
+	void set_period_detection(bool enabled);
+
+	/**
+	 * The number of ticks after which the states repeat, or zero if no period was detected since the last edit.
+	 */
+	[[nodiscard]] uint32_t get_period() const { return period; }
+
+	/**
+	 * Gets the state of a wire, where bit 0 indicates whether it is powered by a gate and bit 1 indicates whether it is strong powered.
+	 */
+	[[nodiscard]] uint8_t get_state(Index index) const;
+
+	/**
+	 * Gets the raw states of all wires, packed as pairs of 64 bit words (powered and strong) for every 64 state slots.
+	 * @param size The number of bytes in data.
+	 */
 	void get_states(const void*& data, size_t& size) const;
 
+	/**
+	 * Gets the state slot of every wire as a 32 bit integer indexed by the wire Index, which locates the wire in the raw states.
+	 * @param size The number of bytes in data.
+	 */
+	void get_slots(const void*& data, size_t& size) const;
+
+	/**
+	 * A number that changes whenever the state slots returned by get_slots change, so copies of them can be reused until then.
+	 */
+	[[nodiscard]] uint64_t get_slots_version() const { return slots_version; }
+
+	/**
+	 * Reads an engine from version 3 files, which stored one state byte per wire instead of packed words.
+	 */
+	void read_unpacked(BinaryReader& reader);
+
 	friend BinaryWriter& operator<<(BinaryWriter& writer, const Engine& engine);
 	friend BinaryReader& operator>>(BinaryReader& reader, Engine& engine);
 
 private:
-	std::vector<uint8_t> states, states_next;
+	/**
+	 * The states of 64 consecutive wires as two bit planes.
+	 */
+	struct StateWord
+	{
+		uint64_t powered; //Whether a gate outputted high to the wire during the last tick
+		uint64_t strong;  //Whether the wire is strong powered, which also makes it powered
+	};
+
+	/**
+	 * Evaluates a gate in the kernel directly from the states.
+	 */
+	[[nodiscard]] bool evaluate_gate(size_t index) const;
+
+	[[nodiscard]] Index get_slot(Index wire) const;
 
+	/**
+	 * Builds the structure of arrays read by the gate evaluation kernel from the gates, in the order returned by reorder.
+	 */
+	void compile_kernel();
+
+	/**
+	 * Renumbers and compacts the state slots in breadth first order over the gate-wire graph, so gates sharing wires are near each other in memory.
+	 * @return The live gates in the same breadth first order.
+	 */
+	std::vector<uint32_t> reorder();
+
+	/**
+	 * Evaluates the kernel gates in range [begin, end) using effective_states and ORs their outputs into a powered plane.
+	 * @param stride The distance (in 64 bit words) between consecutive words of the powered plane.
+	 */
+	void evaluate_kernel(size_t begin, size_t end, uint64_t* powered, size_t stride) const;
+
+	/**
+	 * Performs up to count ticks, stopping early after a tick that changed nothing if until_stable is true.
+	 * @return The number of ticks performed.
+	 */
+	uint32_t execute(uint32_t count, bool until_stable);
+
+	void tick_sweep();
+	void tick_batch();
+	void tick_event();
+	uint32_t tick_parallel(uint32_t count, bool until_stable);
+
+	/**
+	 * Discards everything known about the period because the states or the gates were edited.
+	 */
+	void invalidate_period();
+
+	/**
+	 * Recomputes the hash of the states and restarts the period detection from the current states.
+	 */
+	void reset_period();
+
+	/**
+	 * Records the hash of the states after a tick for period detection, and sets the period once the states are confirmed
+	 * to repeat, which execute checks before every tick to skip whole periods.
+	 */
+	void record_period();
+
+	/**
+	 * Performs a sweep tick while rebuilding all data used by Mode::Event.
+	 */
+	void tick_rebuild();
+
+	void mark_dirty_wire(Index index);
+
+	/**
+	 * Gives every wire the state slot equal to its index and reads the gates, after the states are read.
+	 */
+	void read_gates(BinaryReader& reader);
+
+	static size_t get_word(Index index) { return index >> WordSizeLog2; }
+
+	static uint64_t get_mask(Index index) { return uint64_t(1) << (index & (WordSize - 1)); }
+
+	std::vector<StateWord> states, states_next; //Indexed by state slot, not wire Index
+	std::vector<Index> wire_slots;              //The state slot of each wire Index
+	std::vector<Index> slot_wires;              //The wire Index owning each state slot
+	std::vector<Index> free_slots;
+	uint64_t slots_version = 0;
+
+	std::vector<StateWord> lanes, lanes_next; //The states of each slot across all lanes of Mode::Batch, indexed by state slot
+	std::vector<uint64_t> lanes_effective;    //Whether each slot is powered in each lane, offset by WordSize slots that are always high
+
+	std::vector<Index> gates_internal; //The position of each gate Index in the dense gate arrays below
+	std::vector<Index> gates_external; //The gate Index at each position in the dense gate arrays
 	std::vector<Index> gates_output;
 	std::vector<uint8_t> gates_transistor;
 	std::vector<std::array<Index, 3>> gates_inputs;
+
+	bool kernel_dirty = true; //Whether the gates or the state slots changed since the kernel was last compiled
+	std::vector<uint32_t> kernel_outputs;
+	std::array<std::vector<uint32_t>, 3> kernel_inputs; //Slots in effective_states, unconnected inputs use the always high KernelHighSlot
+	std::vector<uint32_t> kernel_transistors;            //All bits set for transistors and zero for inverters
+	std::vector<uint64_t> effective_states;              //Whether each wire is powered, offset by a leading word that is always high
+
+	Mode mode = Mode::Sweep;
+	size_t changed_words = 0;
+	bool events_dirty = true; //Whether the netlist or the wires changed since the last rebuild
+
+	//Wire to gate fanout index, where the gates reading the wire in slot i are in range [fanout_offsets[i], fanout_offsets[i + 1])
+	std::vector<uint32_t> fanout_offsets;
+	std::vector<Index> fanout_gates;
+
+	std::vector<uint32_t> wires_drivers; //The number of gates outputting high to each wire
+	std::vector<uint8_t> gates_powered;  //The output of each kernel gate during the last tick
+	std::vector<uint8_t> gates_queued;
+
+	std::vector<Index> dirty_wires; //Wires with states changed since the gates last read them
+	std::vector<uint64_t> dirty_wires_mask;
+	std::vector<Index> touched_wires; //Wires with drivers changed during the current tick
+	std::vector<uint64_t> touched_wires_mask;
+	std::vector<Index> queued_gates;
+
+	uint32_t thread_count = get_default_thread_count();
+	bool vectorized = true;
+	std::shared_ptr<ThreadPool> thread_pool; //Shared between copies since it does not hold any Engine data
+	std::vector<std::vector<uint64_t>> partial_powered; //The powered plane written by the gates of each thread
+	std::vector<size_t> partial_changed;                //The number of words changed in the range of each thread
+	std::vector<uint64_t> partial_hashes;
+
+	bool period_detection = false;
+	bool period_dirty = true;
+	uint32_t period = 0;
+	uint64_t states_hash = 0; //XOR of the hashes of every powered word, updated from the changed words on every tick
+	uint64_t period_ticks = 0;
+	std::unordered_map<uint64_t, uint64_t> period_history; //The tick each states hash was last seen
+
+	uint32_t candidate_period = 0; //A period suggested by a repeated hash, which is verified against a copy of the states
+	uint32_t candidate_remain = 0;
+	std::vector<uint64_t> candidate_powered;
+
+	static constexpr uint32_t WordSizeLog2 = 6;
+	static constexpr uint32_t WordSize = 1u << WordSizeLog2;
+	static constexpr uint32_t KernelHighSlot = 0;
+	static constexpr size_t PeriodHistoryLimit = 1u << 16;
 };
 
 } // rw
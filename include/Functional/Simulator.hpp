@@ -0,0 +1,183 @@
+#pragma once
+
+#include "main.hpp"
+#include "Utility/SimpleTypes.hpp"
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace rw
+{
+
+/**
+ * Ticks an Engine on a dedicated background thread, so the rate of ticks is decoupled from the rate of frames.
+ * The states are published as immutable snapshots into a triple buffer, which a reader can acquire without ever waiting for the ticks.
+ */
+class Simulator : NonCopyable
+{
+public:
+	using Duration = std::chrono::nanoseconds;
+
+	/**
+	 * A range [begin, end) of elements in Snapshot::states.
+	 */
+	struct Range
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	/**
+	 * A copy of the engine states taken between two batches of ticks.
+	 */
+	struct Snapshot
+	{
+		std::vector<uint64_t> states;                       //The raw states, see Engine::get_states
+		std::shared_ptr<const std::vector<uint32_t>> slots; //The state slots, see Engine::get_slots
+		uint64_t slots_version = 0;
+
+		/**
+		 * Sequence numbers are unique across all snapshots of all simulators, and increase with every publish.
+		 * Elements of states outside of changed are identical to those in the snapshot with base_sequence,
+		 * which is a snapshot the reader acquired before, or zero if every element is in changed.
+		 */
+		uint64_t sequence = 0;
+		uint64_t base_sequence = 0;
+		std::vector<Range> changed;
+	};
+
+	/**
+	 * The progress of the simulation thread since the last Simulator::collect.
+	 */
+	struct Progress
+	{
+		uint64_t executed_count = 0; //The number of ticks performed
+		Duration executed_duration{};
+		uint64_t remain_count = 0; //The number of requested ticks not performed yet
+		uint32_t period = 0;
+		bool stable = false;
+	};
+
+	/**
+	 * Exclusive access to the Engine from another thread, acquired between two batches of ticks.
+	 * A new snapshot is published once the access is released, so edits are shown immediately.
+	 */
+	class Access : NonCopyable
+	{
+	public:
+		explicit Access(Simulator& simulator);
+		~Access();
+
+		Engine& operator*() const { return simulator.engine; }
+
+		Engine* operator->() const { return &simulator.engine; }
+
+	private:
+		Simulator& simulator;
+	};
+
+	explicit Simulator(Engine& engine);
+	~Simulator();
+
+	/**
+	 * Blocks until the simulation thread finishes its current batch of ticks, then pauses it until the Access is released.
+	 * Commands queued before this call are performed first, so they are never reordered with edits.
+	 */
+	[[nodiscard]] Access lock() { return Access(*this); }
+
+	/**
+	 * Queues a command to be invoked on the simulation thread with exclusive access to the Engine, between two batches of ticks.
+	 */
+	void enqueue(std::function<void(Engine&)> command);
+
+	/**
+	 * Requests count more ticks to be performed as soon as possible.
+	 * @param settle Whether to stop the requested ticks early once a tick no longer changes any state.
+	 */
+	void request_ticks(uint64_t count, bool settle = false);
+
+	/**
+	 * Discards requested ticks that are not performed yet, so at most limit of them remain.
+	 * @return The number of discarded ticks.
+	 */
+	uint64_t trim_ticks(uint64_t limit);
+
+	/**
+	 * Sets whether ticks are continuously performed as fast as possible, regardless of the requested ticks.
+	 */
+	void set_continuous(bool enabled);
+
+	/**
+	 * Sets whether to stop performing ticks; queued commands are still performed while paused.
+	 */
+	void set_paused(bool enabled);
+
+	/**
+	 * Sets the maximum time the simulation thread ticks before publishing a snapshot and performing the queued commands.
+	 */
+	void set_time_budget(Duration budget);
+
+	/**
+	 * Takes the number of ticks performed and the time spent performing them since the last call.
+	 */
+	Progress collect();
+
+	/**
+	 * Gets the most recently published snapshot without waiting for the simulation thread.
+	 * Only a single thread may acquire snapshots, and the returned snapshot is valid until its next acquire.
+	 */
+	const Snapshot& acquire_snapshot();
+
+private:
+	void work();
+
+	/**
+	 * Performs every queued command, must be invoked with exclusive access to the Engine.
+	 */
+	void perform_commands();
+
+	/**
+	 * Copies the Engine states into the back buffer and swaps it with the middle buffer,
+	 * must be invoked with exclusive access to the Engine.
+	 */
+	void publish();
+
+	Engine& engine;
+	std::mutex engine_mutex;
+	std::thread worker;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<std::function<void(Engine&)>> commands;
+	uint32_t waiting_count = 0; //The number of threads waiting for an Access, which the simulation thread yields to
+	bool stopping = false;
+
+	uint64_t remain_count = 0;
+	bool settling = false;
+	bool continuous = false;
+	bool paused = false;
+	Duration time_budget = std::chrono::milliseconds(10);
+	Duration execute_rate = std::chrono::microseconds(1); //The estimated time spent on each tick
+
+	Progress progress;
+
+	//Only the front buffer is read by the reader, and only the back buffer is written by publish
+	std::array<Snapshot, 3> buffers;
+	uint32_t front_index = 0;
+	uint32_t back_index = 1;
+	uint32_t published_index = 0; //The buffer most recently published, which is not written until the next publish
+	std::atomic<uint32_t> middle_index = 2; //Includes FreshBit if the middle buffer was published but not acquired yet
+	std::atomic<uint64_t> acquired_sequence = 0;
+
+	std::vector<uint64_t> word_sequences; //The sequence of the last snapshot that changed each pair of state words
+
+	static constexpr uint32_t FreshBit = 4;
+	static constexpr uint32_t RangeMergeGap = 16; //Changed ranges closer than this number of elements are merged
+};
+
+}
@@ -3,8 +3,8 @@
 #include "main.hpp"
 #include "Utility/SimpleTypes.hpp"
 #include "Utility/Functions.hpp"
+#include "Utility/PositionSet.hpp"
 
-#include <unordered_set>
 #include <span>
 
 namespace rw
@@ -159,6 +159,24 @@ public:
 
 	static void erase(Layer& layer, Int2 position);
 
+	/**
+	 * Inserts wires on every empty tile of a horizontal or vertical line from one position to another (inclusive).
+	 * With auto_bridge, tiles with wires beside the line become bridges instead, replacing any wire already there.
+	 */
+	static void insert_line(Layer& layer, Int2 from, Int2 to, bool auto_bridge);
+
+	/**
+	 * Inserts wires on many empty tiles at once, so the neighboring wires of each group
+	 * of connected positions are merged only once and each neighboring gate is updated only once.
+	 */
+	static void insert_positions(Layer& layer, const PositionSet& positions);
+
+	/**
+	 * Erases the wires and bridges on many tiles at once, so each affected wire has its
+	 * connectivity rebuilt only once, after every tile is gone, instead of once per tile.
+	 */
+	static void erase_positions(Layer& layer, const PositionSet& positions, const PositionSet& bridges);
+
 	static void draw(DrawContext& context, Int2 position, Index index, const Layer& layer);
 
 	/**
@@ -201,6 +219,11 @@ public:
 	 */
 	static void split_positions(Layer& layer, std::vector<Int2>& positions, Index wire_index);
 
+	/**
+	 * Moves positions that are disconnected from the rest of a wire into a new wire, along with their bridges and gates.
+	 */
+	static void separate_positions(Layer& layer, Index wire_index, PositionSet& positions);
+
 	friend BinaryWriter& operator<<(BinaryWriter& writer, const Wire& wire);
 	friend BinaryReader& operator>>(BinaryReader& reader, Wire& wire);
 
@@ -213,13 +236,19 @@ public:
 	static constexpr uint32_t ColorStrong = make_color(247, 137, 27);
 
 private:
-	std::unordered_set<Int2> positions;
-	std::unordered_set<Int2> bridges;
+	PositionSet positions;
+	PositionSet bridges;
+	PositionSet gates;
 
 	//The `bridges` set contains all bridges that are adjacent to `positions` in this wire
 	//But the two sets are disjoint, so bridges are not contained within the `positions` set
 
+	//The `gates` set contains the positions of all gates that were connected to this wire when they were updated
+	//It can also contain gates that have since been disconnected or erased, so it is only used to find gates to update
+
+	friend Layer;
 	friend Bridge;
+	friend Gate;
 	friend Debugger;
 };
 
@@ -295,6 +324,7 @@ private:
 	TileRotation rotation;
 	std::array<Index, 4> wire_indices;
 
+	friend Layer;
 	friend Debugger;
 };
 
@@ -4,7 +4,10 @@
 #include "Application.hpp"
 #include "Utility/SimpleTypes.hpp"
 #include "Functional/Tiles.hpp"
+#include "Functional/Engine.hpp"
+#include "Functional/Simulator.hpp"
 
+#include <span>
 #include <chrono>
 
 namespace rw
@@ -20,6 +23,11 @@ public:
 
 	[[nodiscard]] Layer* get_layer() const { return layer.get(); }
 
+	/**
+	 * The Simulator ticking the Engine of the current layer, which must be locked before editing the layer.
+	 */
+	[[nodiscard]] Simulator* get_simulator() const { return simulator.get(); }
+
 private:
 	enum class ActionType : uint8_t
 	{
@@ -32,6 +40,7 @@ private:
 	void update_interface();
 
 	std::unique_ptr<Layer> layer;
+	std::unique_ptr<Simulator> simulator; //Declared after layer so it stops before the layer is destroyed
 	std::array<char, 100> path_buffer{};
 
 	ActionType selected_action = ActionType::None;
@@ -66,6 +75,11 @@ public:
 
 	[[nodiscard]] const sf::RenderStates& get_render_states() const { return *render_states; }
 
+	/**
+	 * The number of bytes of wire states and slots uploaded to the GPU during the last frame.
+	 */
+	[[nodiscard]] size_t get_uploaded_size() const { return uploaded_size; }
+
 	void set_aspect_ratio(float value)
 	{
 		if (value == aspect_ratio) return;
@@ -133,7 +147,7 @@ private:
 	void update_render_states();
 
 	void draw_grid() const;
-	void draw_layer(const Layer& layer) const;
+	void draw_layer(const Layer& layer, const Simulator::Snapshot& snapshot);
 
 	Controller* controller{};
 
@@ -152,6 +166,11 @@ private:
 	std::unique_ptr<DrawContext> draw_context;
 	std::unique_ptr<sf::RenderStates> render_states;
 
+	uint64_t uploaded_sequence = 0; //The sequence of the snapshot with states matching the uploaded states
+	size_t uploaded_states_size = 0;
+	std::shared_ptr<const std::vector<uint32_t>> uploaded_slots;
+	size_t uploaded_size = 0;
+
 	static constexpr int32_t ZoomIncrement = 8;
 	static constexpr float ZoomLevelShift = 0.7f;
 	static constexpr float GridLineAlpha = 45.0f;
@@ -365,7 +384,7 @@ public:
 
 	void set_rotation(TileRotation new_rotation) { rotation = new_rotation; }
 
-	void paste(Int2 position, Layer& layer) const;
+	void paste(std::span<const Int2> positions, Layer& layer) const;
 	void draw(Int2 position, DrawContext& context, const LayerView& layer_view) const;
 
 private:
@@ -391,6 +410,11 @@ public:
 
 	void resume() { selected_pause = false; }
 
+	/**
+	 * Sends the engine settings again on the next update, because the simulator was replaced.
+	 */
+	void reset_configuration() { configured = false; }
+
 private:
 	using Clock = std::chrono::high_resolution_clock;
 	using Duration = std::chrono::time_point<Clock>::duration;
@@ -407,7 +431,7 @@ private:
 	{
 		TicksPair() = default;
 
-		TicksPair(Duration duration, uint32_t count) : duration(duration), count(count) {}
+		TicksPair(Duration duration, uint64_t count) : duration(duration), count(count) {}
 
 		TicksPair& operator+=(TicksPair other)
 		{
@@ -422,15 +446,25 @@ private:
 
 	void update_interface();
 	void update_display();
-	void update(Engine& engine);
-
-	uint32_t execute(Engine& engine, uint64_t count);
+	void update(Simulator& simulator);
 
 	void begin_manual()
 	{
 		remain_count = selected_count;
+		settling = false;
+		executed = {};
+		update_display();
+		controller->get_simulator()->request_ticks(remain_count);
+	}
+
+	void begin_settle()
+	{
+		remain_count = selected_count;
+		settling = true;
 		executed = {};
 		update_display();
+		display_settle_depth.clear();
+		controller->get_simulator()->request_ticks(remain_count, true);
 	}
 
 	static constexpr Duration as_duration(uint32_t milliseconds)
@@ -442,6 +476,9 @@ private:
 	Controller* controller{};
 
 	Type selected_type = Type::PerSecond;
+	Engine::Mode selected_mode = Engine::Mode::Sweep;
+	uint32_t selected_thread_count = Engine::get_default_thread_count();
+	bool selected_period_detection = false;
 	uint64_t selected_count = 32;
 	bool selected_pause = false;
 
@@ -450,14 +487,23 @@ private:
 	std::string display_frames_per_second;
 	std::string display_ticks_per_second;
 	std::string display_dropped_ticks;
+	std::string display_settle_depth;
+	uint32_t display_period = 0;
 
 	uint64_t remain_count{};
+	bool settling = false;
 	uint64_t dropped_count = 0;
 	float per_second_error = 0.0f;
 
 	Duration time_budget = as_duration(10);
-	Duration last_execute_rate = time_budget / 10;
 	TicksPair executed;
+
+	//The engine settings last sent to the simulator, which are only sent again once they change
+	//Sending them wakes the simulation thread and publishes all states, so it is not done every frame
+	bool configured = false;
+	Engine::Mode configured_mode = Engine::Mode::Sweep;
+	uint32_t configured_thread_count = 0;
+	bool configured_period_detection = false;
 };
 
 class Debugger : public Component
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "main.hpp"
+#include "SimpleTypes.hpp"
+
+#include <bit>
+#include <array>
+#include <iterator>
+
+namespace rw
+{
+
+/**
+ * A set of positions, stored as a bitmask for every block of positions that contains any of them.
+ * The blocks are kept contiguous for cache friendly iteration and are found through an open addressing table,
+ * so only positions in new blocks allocate, and the union of two sets is a bitwise or of their blocks.
+ */
+class PositionSet
+{
+public:
+	class Iterator;
+
+	[[nodiscard]] size_t size() const { return count; }
+
+	[[nodiscard]] bool empty() const { return count == 0; }
+
+	[[nodiscard]] bool contains(Int2 position) const;
+
+	/**
+	 * @return Whether the position was not in the set before.
+	 */
+	bool insert(Int2 position);
+
+	/**
+	 * Inserts every position in another set.
+	 */
+	void insert(const PositionSet& other);
+
+	/**
+	 * @return Whether the position was in the set before.
+	 */
+	bool erase(Int2 position);
+
+	/**
+	 * Erases every position in another set.
+	 */
+	void erase(const PositionSet& other);
+
+	void clear();
+
+	/**
+	 * @return Whether any position is in both this set and another set.
+	 */
+	[[nodiscard]] bool intersects(const PositionSet& other) const;
+
+	/**
+	 * Invokes action with the position in block space of every block that contains any position.
+	 */
+	template<class Action>
+	void for_each_block(Action action) const
+	{
+		for (const Block& block : blocks) action(block.position);
+	}
+
+	[[nodiscard]] Iterator begin() const;
+	[[nodiscard]] Iterator end() const;
+
+	//The same size as Layer::Chunk, so the blocks of a wire line up with the chunks of its layer
+	static constexpr uint32_t SizeLog2 = 5;
+	static constexpr uint32_t Size = 1u << SizeLog2;
+
+private:
+	struct Block
+	{
+		Int2 position; //In block space, similar to Layer::Chunk::chunk_position
+		std::array<uint32_t, Size> rows{};
+	};
+
+	[[nodiscard]] uint32_t find(Int2 block_position) const;
+
+	uint32_t find_or_emplace(Int2 block_position);
+
+	void erase_block(uint32_t index);
+
+	void rebuild_table();
+
+	[[nodiscard]] size_t get_slot(Int2 block_position) const;
+
+	static Int2 get_block_position(Int2 position) { return { position.x >> SizeLog2, position.y >> SizeLog2 }; }
+
+	static Int2 get_local_position(Int2 position) { return { position.x & (Size - 1), position.y & (Size - 1) }; }
+
+	std::vector<Block> blocks;
+	std::vector<uint32_t> table; //Indices into blocks plus one, or zero for empty slots; only used when there are many blocks
+	size_t count = 0;
+
+	static constexpr uint32_t Invalid = std::numeric_limits<uint32_t>::max();
+	static constexpr size_t TableThreshold = 8; //With at most this many blocks, they are found with a linear search instead of the table
+};
+
+class PositionSet::Iterator
+{
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = Int2;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const Int2*;
+	using reference = Int2;
+
+	Iterator() = default;
+
+	Int2 operator*() const
+	{
+		Int2 corner = block->position * static_cast<int32_t>(Size);
+		return corner + Int2(std::countr_zero(bits), row);
+	}
+
+	Iterator& operator++()
+	{
+		bits &= bits - 1;
+		if (bits == 0) advance();
+		return *this;
+	}
+
+	Iterator operator++(int)
+	{
+		Iterator result = *this;
+		++*this;
+		return result;
+	}
+
+	bool operator==(const Iterator& other) const { return block == other.block && row == other.row && bits == other.bits; }
+
+private:
+	Iterator(const Block* block, const Block* end) : block(block), end(end), row(-1)
+	{
+		advance();
+	}
+
+	/**
+	 * Moves to the next row with any position, or to the end.
+	 */
+	void advance()
+	{
+		while (block != end)
+		{
+			while (++row < static_cast<int32_t>(Size))
+			{
+				bits = block->rows[row];
+				if (bits != 0) return;
+			}
+
+			++block;
+			row = -1;
+		}
+
+		row = 0;
+		bits = 0;
+	}
+
+	const Block* block = nullptr;
+	const Block* end = nullptr;
+	int32_t row = 0;
+	uint32_t bits = 0;
+
+	friend PositionSet;
+};
+
+inline PositionSet::Iterator PositionSet::begin() const
+{
+	return { blocks.data(), blocks.data() + blocks.size() };
+}
+
+inline PositionSet::Iterator PositionSet::end() const
+{
+	return { blocks.data() + blocks.size(), blocks.data() + blocks.size() };
+}
+
+}
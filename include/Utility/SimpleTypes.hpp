@@ -489,9 +489,11 @@ struct hash<rw::Int2>
 {
 	size_t operator()(rw::Int2 value) const noexcept
 	{
-		size_t x = std::hash<int32_t>()(value.x);
-		size_t y = std::hash<int32_t>()(value.y);
-		return x ^ (y + 0x9E3779B9 + (x << 6) + (x >> 2));
+		//Both coordinates are packed and mixed with the MurmurHash3 finalizer, so every bit of the result depends on every bit of them
+		uint64_t packed = static_cast<uint64_t>(static_cast<uint32_t>(value.x)) << 32 | static_cast<uint32_t>(value.y);
+		packed = (packed ^ packed >> 33) * 0xFF51AFD7ED558CCDull;
+		packed = (packed ^ packed >> 33) * 0xC4CEB9FE1A85EC53ull;
+		return static_cast<size_t>(packed ^ packed >> 33);
 	}
 };
 
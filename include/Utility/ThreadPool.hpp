@@ -0,0 +1,49 @@
+#pragma once
+
+#include "main.hpp"
+#include "SimpleTypes.hpp"
+
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace rw
+{
+
+/**
+ * A persistent set of worker threads that can repeatedly execute a job together with the calling thread.
+ */
+class ThreadPool : NonCopyable
+{
+public:
+	/**
+	 * @param count The total number of threads, including the thread calling run.
+	 */
+	explicit ThreadPool(uint32_t count);
+	~ThreadPool();
+
+	[[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+	/**
+	 * Invokes action once for every thread index in [0, size()) and blocks until all invocations return.
+	 * The invocation with thread index zero is performed on the calling thread.
+	 */
+	void run(const std::function<void(uint32_t)>& action);
+
+private:
+	void work(uint32_t index);
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable start_condition;
+	std::condition_variable finish_condition;
+
+	const std::function<void(uint32_t)>* job = nullptr;
+	uint64_t generation = 0;
+	uint32_t remain = 0;
+	bool stopping = false;
+};
+
+}
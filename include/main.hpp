@@ -27,6 +27,7 @@ namespace rw
 class Board;
 class Layer;
 class Engine;
+class Simulator;
 class DataBuffer;
 class VertexBuffer;
 class ShaderResources;
@@ -55,5 +56,6 @@ typedef Vector2<int32_t> Int2;
 class Index;
 class BinaryWriter;
 class BinaryReader;
+class ThreadPool;
 
 }
@@ -9,6 +9,13 @@ layout (binding = 0, std430) readonly buffer wires
     uint states[];
 };
 
+layout (binding = 1, std430) readonly buffer slots
+{
+    uint wire_slots[];
+};
+
+uniform bool unpowered; //Whether the wire indices have no states, such as those of the clipboard
+
 out vec4 vertex_color;
 
 vec3 make_color(uint red, uint green, uint blue)
@@ -20,12 +27,17 @@ void main()
 {
     gl_Position = get_position(in_position);
 
-    uint chunk = states[in_index / 4];
-    uint offset = (in_index % 4) * 8;
-    uint state = (chunk >> offset) & 0xFFu;
+    uint state = 0u;
+
+    if (!unpowered)
+    {
+        //Every state slot is packed as two consecutive bits (powered then strong), so each uint holds 16 slots
+        uint slot = wire_slots[in_index];
+        state = states[slot / 16] >> (slot % 16 * 2);
+    }
 
-    bool powered = state != 0;
     bool strong = (state & 2u) != 0;
+    bool powered = strong || (state & 1u) != 0;
 
     const vec3 ColorUnpowered = make_color(71, 0, 22);
     const vec3 ColorPowered = make_color(254, 22, 59);
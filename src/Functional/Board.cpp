@@ -1,13 +1,14 @@
 #include "Functional/Board.hpp"
 #include "Functional/Tiles.hpp"
 #include "Functional/Engine.hpp"
-#include "Functional/Drawing.hpp"
 
-#include "SFML/Graphics.hpp"
+#include <numeric>
 
 namespace rw
 {
 
+static constexpr std::array<Int2, 4> FourDirections = { Int2(1, 0), Int2(0, 1), Int2(-1, 0), Int2(0, -1) };
+
 Board::Board() = default;
 
 Layer::Layer() : lists(std::make_unique<ListsType>()), engine(std::make_unique<Engine>()) {}
@@ -19,7 +20,10 @@ TileTag Layer::get(Int2 position) const
 	Int2 chunk_position = Chunk::get_chunk_position(position);
 	auto iterator = chunks.find(chunk_position);
 	if (iterator == chunks.end()) return TileTag();
-	return iterator->second->get(position);
+
+	TileTag tile = iterator->second->get(position);
+	if (tile.type == TileType::Wire) tile.index = find_wire(tile.index);
+	return tile;
 }
 
 bool Layer::has(Int2 position, TileType type) const
@@ -30,19 +34,14 @@ bool Layer::has(Int2 position, TileType type) const
 	return iterator->second->get(position).type == type;
 }
 
-void Layer::draw(DrawContext& context, Float2 min_position, Float2 max_position) const
+void Layer::set(Int2 position, TileTag tile)
 {
-	auto draw = [&context, this](Chunk& chunk)
+	if (tile.type == TileType::Wire)
 	{
-		chunk.update_draw_buffer(context, *this);
-		chunk.draw(context);
-	};
-
-	for_each_chunk(draw, Bounds(min_position, max_position));
-}
+		assert(tile.index < wire_components.size());
+		tile.index = Index(wire_components[tile.index]);
+	}
 
-void Layer::set(Int2 position, TileTag tile)
-{
 	Int2 chunk_position = Chunk::get_chunk_position(position);
 	auto iterator = chunks.find(chunk_position);
 
@@ -62,9 +61,40 @@ void Layer::set(Int2 position, TileTag tile)
 	if (not has_tiles) chunks.erase(iterator);
 }
 
+void Layer::register_wire(Index index)
+{
+	if (index >= wire_components.size()) wire_components.resize(index + 1);
+	auto component = static_cast<uint32_t>(component_parents.size());
+
+	wire_components[index] = component;
+	component_parents.push_back(component);
+	component_wires.push_back(index);
+}
+
+void Layer::merge_wire(Index index, Index target)
+{
+	assert(index != target);
+	uint32_t component = wire_components[index];
+	uint32_t root = wire_components[target];
+
+	assert(component_parents[component] == component);
+	assert(component_parents[root] == root);
+	component_parents[component] = root;
+
+	//The tiles keep their component, but their vertices still refer to the old wire Index, which can be reused from now on
+	//The blocks of the positions line up with the chunks, so only the chunks are visited instead of every position
+	const PositionSet& positions = get_list<Wire>()[index].positions;
+	positions.for_each_block([this](Int2 chunk_position) { chunks.at(chunk_position)->mark_vertices_dirty(); });
+}
+
 void Layer::erase(Bounds bounds)
 {
-	auto erase = [bounds, this](Chunk& chunk)
+	//Gather the tiles before erasing any, so the wires are split once after every tile is gone instead of after each tile
+	PositionSet wires;
+	PositionSet bridges;
+	std::vector<Int2> gates;
+
+	auto gather = [bounds, &wires, &bridges, &gates](const Chunk& chunk)
 	{
 		Int2 chunk_position = chunk.chunk_position * Chunk::Size;
 		Bounds local_bounds = bounds - chunk_position;
@@ -79,32 +109,200 @@ void Layer::erase(Bounds bounds)
 			if (type == TileType::None) continue;
 			position += chunk_position;
 
-			if (type == TileType::Wire) Wire::erase(*this, position);
-			else if (type == TileType::Bridge) Bridge::erase(*this, position);
-			else if (type == TileType::Gate) Gate::erase(*this, position);
+			if (type == TileType::Wire) wires.insert(position);
+			else if (type == TileType::Bridge) bridges.insert(position);
+			else if (type == TileType::Gate) gates.push_back(position);
 			else throw std::domain_error("Unrecognized TileType.");
 
-			//Since empty chunks are automatically removed, check to see when all tiles are removed to avoid accessing a bad chunk
+			//Stop once every tile of the chunk is found
 			if (--remain == 0) break;
 		}
 	};
 
-	for_each_chunk(erase, bounds);
+	for_each_chunk(gather, bounds);
+
+	for (Int2 position : gates) Gate::erase(*this, position);
+	Wire::erase_positions(*this, wires, bridges);
+}
+
+void Layer::paste(const Layer& source, Bounds bounds, TileRotation rotation, std::span<const Int2> positions)
+{
+	assert(&source != this);
+
+	//Precalculate transformation parameters
+	Int2 size = bounds.size();
+	if (rotation.vertical()) std::swap(size.x, size.y);
+
+	Int2 one_less = size - Int2(1);
+	Int2 multiplier = Int2(1);
+	Int2 corner;
+
+	if (rotation == TileRotation::Angle180 || rotation == TileRotation::Angle90)
+	{
+		multiplier.x = -1;
+		corner.x = one_less.x;
+	}
+
+	if (rotation == TileRotation::Angle180 || rotation == TileRotation::Angle270)
+	{
+		multiplier.y = -1;
+		corner.y = one_less.y;
+	}
+
+	struct PendingGate
+	{
+		Int2 position;
+		Gate::Type type;
+		TileRotation rotation;
+	};
+
+	//Bridges are inserted right away, while wires and gates wait until every copy is placed
+	//so that the wires are connected once and every gate is registered once with its final wires
+	PositionSet pending;
+	PositionSet wires;
+	std::vector<PendingGate> gates;
+
+	auto paste_chunk = [&](const Chunk& chunk)
+	{
+		Int2 chunk_position = chunk.chunk_position * Chunk::Size;
+		Bounds local_bounds = bounds - chunk_position;
+
+		Int2 min = local_bounds.get_min().max(Int2(0));
+		Int2 max = local_bounds.get_max().min(Int2(static_cast<int32_t>(Chunk::Size)));
+
+		for (Int2 local : Bounds(min, max))
+		{
+			TileTag tile = chunk.get(local);
+			if (tile.type == TileType::None) continue;
+
+			//Transform the position based on rotation
+			Int2 offset = local + chunk_position - bounds.get_min();
+			if (rotation.vertical()) std::swap(offset.x, offset.y);
+			offset = offset * multiplier + corner;
+
+			for (Int2 position : positions)
+			{
+				Int2 current = offset + position;
+				if (not has(current, TileType::None) || not pending.insert(current)) continue;
+
+				switch (tile.type.get_value())
+				{
+					case TileType::Wire:
+					{
+						wires.insert(current);
+						break;
+					}
+					case TileType::Bridge:
+					{
+						Bridge::insert(*this, current);
+						break;
+					}
+					case TileType::Gate:
+					{
+						const Gate& gate = source.get_list<Gate>()[tile.index];
+						gates.push_back({ current, gate.get_type(), rotation.rotate(gate.get_rotation()) });
+						break;
+					}
+					default: throw std::domain_error("Unrecognized TileType.");
+				}
+			}
+		}
+	};
+
+	source.for_each_chunk(paste_chunk, bounds);
+
+	Wire::insert_positions(*this, wires);
+	for (const PendingGate& gate : gates) Gate::insert(*this, gate.position, gate.type, gate.rotation);
 }
 
 Layer Layer::copy(Bounds bounds) const
 {
 	Layer layer;
+	layer.engine = nullptr;
+
+	auto& wires = layer.get_list<Wire>();
+	auto& bridges = layer.get_list<Bridge>();
+	auto& gates = layer.get_list<Gate>();
 
-	auto copy_chunk = [&layer](const Chunk& chunk)
+	std::unordered_map<Index, Index> wire_indices; //From the wires of this layer to the wires of the copy
+	std::vector<Int2> bridge_positions;
+	std::vector<Int2> gate_positions;
+
+	auto copy_chunk = [&](const Chunk& chunk)
 	{
-		auto pointer = std::make_unique<Chunk>(chunk);
-		layer.chunks.emplace(chunk.chunk_position, std::move(pointer));
+		Int2 chunk_position = chunk.chunk_position * Chunk::Size;
+		Bounds local_bounds = bounds - chunk_position;
+
+		Int2 min = local_bounds.get_min().max(Int2(0));
+		Int2 max = local_bounds.get_max().min(Int2(static_cast<int32_t>(Chunk::Size)));
+		auto pointer = std::make_unique<Chunk>(chunk.chunk_position);
+
+		for (Int2 local : Bounds(min, max))
+		{
+			TileTag tile = chunk.get(local);
+			Int2 position = local + chunk_position;
+
+			switch (tile.type.get_value())
+			{
+				case TileType::None: continue;
+				case TileType::Wire:
+				{
+					auto [iterator, inserted] = wire_indices.try_emplace(find_wire(tile.index));
+					if (inserted) iterator->second = wires.emplace();
+
+					tile.index = iterator->second;
+					wires[tile.index].positions.insert(position);
+					break;
+				}
+				case TileType::Bridge:
+				{
+					tile.index = bridges.emplace();
+					bridge_positions.push_back(position);
+					break;
+				}
+				case TileType::Gate:
+				{
+					const Gate& gate = get_list<Gate>()[tile.index];
+					tile.index = gates.emplace(gate.get_type(), gate.get_rotation());
+					gate_positions.push_back(position);
+					break;
+				}
+				default: throw std::domain_error("Unrecognized TileType.");
+			}
+
+			pointer->set(local, tile);
+		}
+
+		if (pointer->count() > 0) layer.chunks.emplace(chunk.chunk_position, std::move(pointer));
 	};
 
 	for_each_chunk(copy_chunk, bounds);
-	layer.lists = std::make_unique<ListsType>(*lists);
-	layer.engine = std::make_unique<Engine>(*engine);
+	layer.reset_components();
+
+	//Connect the bridges and gates to the copied wires next to them, which are all that remain of their wires
+	for (Int2 position : bridge_positions)
+	{
+		for (Int2 direction : FourDirections)
+		{
+			TileTag neighbor = layer.get(position + direction);
+			if (neighbor.type == TileType::Wire) wires[neighbor.index].bridges.insert(position);
+		}
+	}
+
+	for (Int2 position : gate_positions)
+	{
+		Gate& gate = gates[layer.get(position).index];
+		TileRotation rotation = gate.rotation;
+
+		for (Index& wire_index : gate.wire_indices)
+		{
+			TileTag neighbor = layer.get(position + rotation.get_direction());
+			wire_index = neighbor.type == TileType::Wire ? neighbor.index : Index();
+			rotation = rotation.get_next();
+		}
+	}
+
+	layer.connect_gates();
 	return layer;
 }
 
@@ -115,7 +313,7 @@ BinaryWriter& operator<<(BinaryWriter& writer, const Layer& layer)
 	for (const auto& [position, chunk] : layer.chunks)
 	{
 		writer << position;
-		chunk->write(writer);
+		chunk->write(writer, layer);
 	}
 
 	return writer << *layer.lists << *layer.engine;
@@ -123,7 +321,14 @@ BinaryWriter& operator<<(BinaryWriter& writer, const Layer& layer)
 
 BinaryReader& operator>>(BinaryReader& reader, Layer& layer)
 {
-	assert(layer.chunks.empty());
+	layer.read(reader, Layer::FileVersion);
+	return reader;
+}
+
+void Layer::read(BinaryReader& reader, uint32_t version)
+{
+	assert(chunks.empty());
+	assert(OldestFileVersion <= version && version <= FileVersion);
 
 	uint32_t size;
 	reader >> size;
@@ -133,54 +338,84 @@ BinaryReader& operator>>(BinaryReader& reader, Layer& layer)
 		Int2 position;
 		reader >> position;
 
-		auto pointer = std::make_unique<Layer::Chunk>(position);
-		auto pair = layer.chunks.emplace(position, std::move(pointer));
+		auto pointer = std::make_unique<Chunk>(position);
+		auto pair = chunks.emplace(position, std::move(pointer));
 		assert(pair.second);
 
-		Layer::Chunk* chunk = pair.first->second.get();
+		Chunk* chunk = pair.first->second.get();
 		chunk->read(reader);
 	}
 
-	return reader >> *layer.lists >> *layer.engine;
+	reader >> *lists;
+
+	if (version == 3) engine->read_unpacked(reader);
+	else reader >> *engine;
+
+	reset_components();
+	connect_gates();
 }
 
-template<class Action>
-void Layer::for_each_chunk(Action action, Bounds bounds) const
+Bounds Layer::to_chunk_space(rw::Bounds bounds)
 {
-	Bounds chunk_bounds = to_chunk_space(bounds);
+	return { Chunk::get_chunk_position(bounds.get_min()),
+	         Chunk::get_chunk_position(bounds.get_max() - Int2(1)) + Int2(1) }; //Exclusive max
+}
 
-	if (chunks.size() < chunk_bounds.size().product())
-	{
-		//Manual while loop to support removal of chunks during iteration
-		auto iterator = chunks.begin();
+Index Layer::find_wire(uint32_t component) const
+{
+	assert(component < component_parents.size());
+	while (component_parents[component] != component) component = component_parents[component];
+	return component_wires[component];
+}
 
-		while (iterator != chunks.end())
-		{
-			Int2 chunk_position = iterator->first;
-			Chunk* chunk = iterator->second.get();
+void Layer::compact()
+{
+	size_t wire_count = get_list<Wire>().size();
+	if (component_parents.size() >= CompactionThreshold && component_parents.size() > wire_count * 2) compact_components();
+}
 
-			++iterator;
-			if (chunk_bounds.contains(chunk_position)) action(*chunk);
-		}
-	}
-	else
+void Layer::compact_components()
+{
+	for (auto& [position, chunk] : chunks) chunk->resolve_wires(*this);
+	reset_components();
+}
+
+void Layer::reset_components()
+{
+	uint32_t size = 0;
+	get_list<Wire>().for_each_index([&size](Index index) { size = std::max(size, index + 1); });
+
+	component_parents.resize(size);
+	component_wires.resize(size);
+	wire_components.resize(size);
+
+	std::iota(component_parents.begin(), component_parents.end(), 0);
+	std::iota(wire_components.begin(), wire_components.end(), 0);
+	for (uint32_t i = 0; i < size; ++i) component_wires[i] = Index(i);
+}
+
+void Layer::connect_gates()
+{
+	auto& wires = get_list<Wire>();
+	const auto& gates = get_list<Gate>();
+
+	for (const auto& [chunk_position, chunk] : chunks)
 	{
-		//Loop through all chunk positions
-		for (Int2 position : chunk_bounds)
+		Int2 corner = chunk_position * Chunk::Size;
+
+		for (Int2 position : Bounds(Int2(0), Int2(static_cast<int32_t>(Chunk::Size))))
 		{
-			auto iterator = chunks.find(position);
-			if (iterator == chunks.end()) continue;
-			action(*iterator->second);
+			TileTag tile = chunk->get(position);
+			if (tile.type != TileType::Gate) continue;
+
+			for (Index wire_index : gates[tile.index].wire_indices)
+			{
+				if (wire_index.valid()) wires[wire_index].gates.insert(corner + position);
+			}
 		}
 	}
 }
 
-Bounds Layer::to_chunk_space(rw::Bounds bounds)
-{
-	return { Chunk::get_chunk_position(bounds.get_min()),
-	         Chunk::get_chunk_position(bounds.get_max() - Int2(1)) + Int2(1) }; //Exclusive max
-}
-
 Layer::Chunk::Chunk(Int2 chunk_position) :
 	chunk_position(chunk_position),
 	tile_types(std::make_unique<decltype(tile_types)::element_type>()),
@@ -199,12 +434,6 @@ TileTag Layer::Chunk::get(Int2 position) const
 
 uint32_t Layer::Chunk::count() const { return occupied_tiles; }
 
-void Layer::Chunk::draw(DrawContext& context) const
-{
-	context.draw(true, vertex_buffer_quad);
-	context.draw(false, vertex_buffer_wire);
-}
-
 bool Layer::Chunk::set(Int2 position, TileTag tile)
 {
 	uint32_t tile_index = get_tile_index(position);
@@ -231,49 +460,17 @@ bool Layer::Chunk::set(Int2 position, TileTag tile)
 	return occupied_tiles > 0;
 }
 
-void Layer::Chunk::update_draw_buffer(DrawContext& context, const Layer& layer)
+void Layer::Chunk::resolve_wires(const Layer& layer)
 {
-	if (not vertices_dirty) return;
-	vertices_dirty = false;
-
-	for (Int2 position : Bounds(Int2(0), Int2(static_cast<int32_t>(Size))))
+	for (size_t i = 0; i < Size2; ++i)
 	{
-		TileTag tile = get(position);
-		position += chunk_position * Size;
-
-		switch (tile.type.get_value())
-		{
-			case TileType::Wire:
-			{
-				Wire::draw(context, position, tile.index, layer);
-				break;
-			}
-			case TileType::Bridge:
-			{
-				Bridge::draw(context, position, tile.index, layer);
-				break;
-			}
-			case TileType::Gate:
-			{
-				Gate::draw(context, position, tile.index, layer);
-				break;
-			}
-			case TileType::None: continue;
-			default:
-			{
-				Float2 corner0(position);
-				Float2 corner1 = corner0 + Float2(1.0f);
-				context.emplace_quad(corner0, corner1, 0xFF00FFFF);
-				break;
-			}
-		}
+		if ((*tile_types)[i] != TileType::Wire) continue;
+		uint32_t& index = (*tile_indices)[i];
+		index = layer.find_wire(index);
 	}
-
-	vertex_buffer_quad = context.flush_buffer(true);
-	vertex_buffer_wire = context.flush_buffer(false);
 }
 
-void Layer::Chunk::write(BinaryWriter& writer) const
+void Layer::Chunk::write(BinaryWriter& writer, const Layer& layer) const
 {
 	TileTag last_tile;
 	uint8_t count = 0;
@@ -291,6 +488,7 @@ void Layer::Chunk::write(BinaryWriter& writer) const
 	for (size_t i = 0; i < Size * Size; ++i)
 	{
 		TileTag tile = get(i);
+		if (tile.type == TileType::Wire) tile.index = layer.find_wire(tile.index);
 
 		if (tile != last_tile)
 		{
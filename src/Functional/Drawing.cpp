@@ -9,6 +9,11 @@
 #include <fstream>
 #include <filesystem>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define PACK_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace rw
 {
 
@@ -73,6 +78,20 @@ void DataBuffer::update_impl(const void* data, size_t new_size)
 	throw_any_gl_error();
 }
 
+void DataBuffer::update_range_impl(const void* data, size_t offset, size_t range_size)
+{
+	assert(valid());
+	assert(offset + range_size <= size);
+	if (range_size == 0) return;
+
+	auto casted_offset = static_cast<GLintptr>(offset);
+	auto casted_size = static_cast<GLsizeiptr>(range_size);
+
+	bind();
+	glBufferSubData(type, casted_offset, casted_size, data);
+	throw_any_gl_error();
+}
+
 #define SET_ATTRIBUTE(Target, Size, Type, Integer)                                             \
 template<>                                                                                     \
 void DataBuffer::set_attribute<Target>(uint32_t attribute, size_t stride, size_t offset) const \
@@ -265,7 +284,8 @@ sf::Shader* ShaderResources::get_shader(bool quad) const
 DrawContext::DrawContext(const ShaderResources& shaders) :
 	shader_quad(shaders.get_shader(true)),
 	shader_wire(shaders.get_shader(false)),
-	wire_states_buffer(GL_SHADER_STORAGE_BUFFER, GL_STREAM_DRAW)
+	wire_states_buffer(GL_SHADER_STORAGE_BUFFER, GL_STREAM_DRAW),
+	wire_slots_buffer(GL_SHADER_STORAGE_BUFFER, GL_STREAM_DRAW)
 {
 	set_rotation(TileRotation());
 }
@@ -309,6 +329,12 @@ void DrawContext::set_rotation(TileRotation new_rotation)
 	shader_dirty = true;
 }
 
+void DrawContext::set_wires_unpowered(bool new_wires_unpowered)
+{
+	wires_unpowered = new_wires_unpowered;
+	shader_dirty = true;
+}
+
 void DrawContext::set_view(Float2 center, Float2 extend)
 {
 	scale = Float2(1.0f) / extend;
@@ -316,11 +342,103 @@ void DrawContext::set_view(Float2 center, Float2 extend)
 	shader_dirty = true;
 }
 
+/**
+ * Spreads the lower 32 bits of value to the even bits of the result.
+ */
+static uint64_t spread_bits(uint64_t value)
+{
+	value &= 0xFFFFFFFFull;
+	value = (value | value << 16) & 0x0000FFFF0000FFFFull;
+	value = (value | value << 8) & 0x00FF00FF00FF00FFull;
+	value = (value | value << 4) & 0x0F0F0F0F0F0F0F0Full;
+	value = (value | value << 2) & 0x3333333333333333ull;
+	value = (value | value << 1) & 0x5555555555555555ull;
+	return value;
+}
+
+/**
+ * Interleaves count pairs of powered and strong words into the render format, where every wire has two
+ * consecutive bits (powered then strong). Each pair of words becomes two words with the same total size.
+ */
+static void pack_wire_states(const uint64_t* source, uint64_t* target, size_t count)
+{
+	size_t index = 0;
+
+#ifdef PACK_SSE2
+	auto spread = [](__m128i value, uint64_t mask, int shift)
+	{
+		value = _mm_or_si128(value, _mm_slli_epi64(value, shift));
+		return _mm_and_si128(value, _mm_set1_epi64x(static_cast<int64_t>(mask)));
+	};
+
+	__m128i zero = _mm_setzero_si128();
+
+	for (; index < count; ++index)
+	{
+		//Place the two halves of the powered and strong words into separate 64 bit lanes
+		__m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index * 2));
+		__m128i powered = _mm_unpacklo_epi32(words, zero);
+		__m128i strong = _mm_unpackhi_epi32(words, zero);
+
+		for (__m128i* value : { &powered, &strong })
+		{
+			*value = spread(*value, 0x0000FFFF0000FFFFull, 16);
+			*value = spread(*value, 0x00FF00FF00FF00FFull, 8);
+			*value = spread(*value, 0x0F0F0F0F0F0F0F0Full, 4);
+			*value = spread(*value, 0x3333333333333333ull, 2);
+			*value = spread(*value, 0x5555555555555555ull, 1);
+		}
+
+		__m128i result = _mm_or_si128(powered, _mm_slli_epi64(strong, 1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(target + index * 2), result);
+	}
+#endif
+
+	for (; index < count; ++index)
+	{
+		uint64_t powered = source[index * 2];
+		uint64_t strong = source[index * 2 + 1];
+		target[index * 2] = spread_bits(powered) | spread_bits(strong) << 1;
+		target[index * 2 + 1] = spread_bits(powered >> 32) | spread_bits(strong >> 32) << 1;
+	}
+}
+
 void DrawContext::set_wire_states(const void* data, size_t size)
+{
+	assert(size % (sizeof(uint64_t) * 2) == 0);
+	packed_states.resize(size / sizeof(uint64_t));
+	pack_wire_states(static_cast<const uint64_t*>(data), packed_states.data(), packed_states.size() / 2);
+
+	wire_states_buffer.update(packed_states.data(), packed_states.size());
+	wire_states_buffer.unbind();
+	uploaded_size += size;
+}
+
+void DrawContext::set_wire_slots(const void* data, size_t size)
 {
 	auto casted = reinterpret_cast<const uint8_t*>(data);
-	wire_states_buffer.update<uint8_t>(casted, size);
+	wire_slots_buffer.update<uint8_t>(casted, size);
+	wire_slots_buffer.unbind();
+	uploaded_size += size;
+}
+
+void DrawContext::update_wire_states(const void* data, size_t offset, size_t size)
+{
+	assert(offset % (sizeof(uint64_t) * 2) == 0);
+	assert(size % (sizeof(uint64_t) * 2) == 0);
+	packed_states.resize(size / sizeof(uint64_t));
+	pack_wire_states(static_cast<const uint64_t*>(data), packed_states.data(), packed_states.size() / 2);
+
+	wire_states_buffer.update_range(packed_states.data(), offset / sizeof(uint64_t), packed_states.size());
 	wire_states_buffer.unbind();
+	uploaded_size += size;
+}
+
+size_t DrawContext::take_uploaded_size()
+{
+	size_t result = uploaded_size;
+	uploaded_size = 0;
+	return result;
 }
 
 void DrawContext::clip(Float2 min_position, Float2 max_position) const
@@ -370,7 +488,9 @@ void DrawContext::draw(bool quad, const VertexBuffer& buffer) const
 	{
 		sf::Shader::bind(shader_wire);
 		wire_states_buffer.bind_base(0);
+		wire_slots_buffer.bind_base(1);
 		buffer.draw();
+		wire_slots_buffer.unbind();
 		wire_states_buffer.unbind();
 	}
 }
@@ -401,6 +521,7 @@ void DrawContext::set_shader_parameters() const
 
 	set_parameters(*shader_quad);
 	set_parameters(*shader_wire);
+	shader_wire->setUniform("unpowered", wires_unpowered);
 }
 
 }
@@ -1,105 +1,1086 @@
 #include "Functional/Engine.hpp"
+#include "Utility/ThreadPool.hpp"
+
+#include <algorithm>
+#include <barrier>
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KERNEL_AVX2
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 namespace rw
 {
 
+/**
+ * Hashes a powered word at a word index, where the hash of all states is the XOR of all word hashes.
+ */
+static uint64_t hash_word(uint64_t word, size_t index)
+{
+	auto mix = [](uint64_t value)
+	{
+		//Finalizer of SplitMix64
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	};
+
+	return mix(word ^ mix(index + 0x9E3779B97F4A7C15ull));
+}
+
+void Engine::set_mode(Mode new_mode)
+{
+	if (mode == new_mode) return;
+
+	if (new_mode == Mode::Batch)
+	{
+		//Every lane starts as a copy of the current states
+		lanes.resize(slot_wires.size());
+
+		for (size_t j = 0; j < lanes.size(); ++j)
+		{
+			const StateWord& word = states[get_word(Index(j))];
+			uint64_t mask = get_mask(Index(j));
+			lanes[j].powered = word.powered & mask ? ~uint64_t(0) : 0;
+			lanes[j].strong = word.strong & mask ? ~uint64_t(0) : 0;
+		}
+	}
+	else if (mode == Mode::Batch)
+	{
+		lanes.clear();
+		lanes_next.clear();
+		lanes_effective.clear();
+	}
+
+	mode = new_mode;
+	events_dirty = true;
+	invalidate_period();
+}
+
+void Engine::set_period_detection(bool enabled)
+{
+	period_detection = enabled;
+	invalidate_period();
+}
+
+void Engine::set_thread_count(uint32_t new_count)
+{
+	thread_count = std::max(new_count, 1u);
+}
+
 void Engine::register_wire(Index index)
 {
-	if (index == states.size())
+	if (index >= wire_slots.size()) wire_slots.resize(index + 1);
+	Index& slot = wire_slots[index];
+
+	//Aliases created by merge_wire do not own their slots, so they also need a new slot
+	if (not slot.valid() || slot_wires[slot] != index)
+	{
+		if (not free_slots.empty())
+		{
+			slot = free_slots.back();
+			free_slots.pop_back();
+		}
+		else
+		{
+			slot = Index(static_cast<uint32_t>(slot_wires.size()));
+			slot_wires.emplace_back();
+
+			if (get_word(slot) == states.size())
+			{
+				states.resize(states.size() + 1);
+				states_next.resize(states.size());
+			}
+		}
+
+		slot_wires[slot] = index;
+		kernel_dirty = true;
+		++slots_version;
+	}
+
+	assert(get_word(slot) < states.size());
+	states[get_word(slot)].powered &= ~get_mask(slot);
+	states[get_word(slot)].strong &= ~get_mask(slot);
+
+	if (mode == Mode::Batch)
+	{
+		lanes.resize(slot_wires.size());
+		lanes[slot] = {};
+	}
+
+	events_dirty = true;
+	invalidate_period();
+}
+
+void Engine::unregister_wire(Index index)
+{
+	assert(index < wire_slots.size());
+	Index& slot = wire_slots[index];
+	assert(slot.valid());
+
+	if (slot_wires[slot] == index)
 	{
-		states.resize(index + 1);
-		states_next.resize(index + 1);
+		states[get_word(slot)].powered &= ~get_mask(slot);
+		states[get_word(slot)].strong &= ~get_mask(slot);
+		slot_wires[slot] = Index();
+		free_slots.push_back(slot);
+		if (mode == Mode::Batch) lanes[slot] = {};
 	}
 
-	assert(index < states.size());
-	states[index] = 0;
+	slot = Index();
+	kernel_dirty = true;
+	events_dirty = true;
+	++slots_version;
+	invalidate_period();
+}
+
+void Engine::merge_wire(Index index, Index target)
+{
+	assert(index != target);
+	assert(slot_wires[wire_slots[target]] == target);
+
+	unregister_wire(index);
+	wire_slots[index] = wire_slots[target];
 }
 
 void Engine::register_gate(Index index, Index output, bool transistor, const std::span<Index>& inputs)
 {
-	if (index == gates_output.size())
+	if (index >= gates_internal.size()) gates_internal.resize(index + 1);
+	Index& internal = gates_internal[index];
+
+	if (not internal.valid())
 	{
-		gates_output.resize(index + 1);
-		gates_inputs.resize(index + 1);
-		gates_transistor.resize(index + 1);
+		internal = Index(static_cast<uint32_t>(gates_output.size()));
+		gates_external.push_back(index);
+		gates_output.emplace_back();
+		gates_transistor.emplace_back();
+		gates_inputs.emplace_back();
 	}
 
-	assert(index < gates_output.size());
-	gates_output[index] = output;
-	gates_transistor[index] = transistor ? 1 : 0;
+	gates_output[internal] = output;
+	gates_transistor[internal] = transistor ? 1 : 0;
 
 	assert(inputs.size() == 3);
-	std::copy(inputs.begin(), inputs.end(), gates_inputs[index].begin());
+	std::copy(inputs.begin(), inputs.end(), gates_inputs[internal].begin());
+	kernel_dirty = true;
+	events_dirty = true;
+	invalidate_period();
 }
 
 void Engine::unregister_gate(Index index)
 {
-	assert(index < gates_output.size());
-	gates_output[index] = Index();
+	assert(index < gates_internal.size());
+	Index internal = gates_internal[index];
+	if (not internal.valid()) return;
+
+	//Swap the last gate into the hole to keep the gates dense
+	Index last = gates_external.back();
+	gates_internal[last] = internal;
+	gates_internal[index] = Index();
+
+	gates_external[internal] = last;
+	gates_output[internal] = gates_output.back();
+	gates_transistor[internal] = gates_transistor.back();
+	gates_inputs[internal] = gates_inputs.back();
+
+	gates_external.pop_back();
+	gates_output.pop_back();
+	gates_transistor.pop_back();
+	gates_inputs.pop_back();
+
+	kernel_dirty = true;
+	events_dirty = true;
+	invalidate_period();
 }
 
 void Engine::toggle_wire_strong_powered(Index index)
 {
-	states[index] ^= 0b10;
+	Index slot = wire_slots[index];
+	states[get_word(slot)].strong ^= get_mask(slot);
+	if (mode == Mode::Batch) lanes[slot].strong = ~lanes[slot].strong;
+	if (mode == Mode::Event && not events_dirty) mark_dirty_wire(slot);
+	invalidate_period();
+}
+
+void Engine::set_strong_lanes(Index index, uint64_t strong)
+{
+	assert(mode == Mode::Batch);
+	Index slot = wire_slots[index];
+	lanes[slot].strong = strong;
+
+	StateWord& word = states[get_word(slot)];
+	if (strong & 1) word.strong |= get_mask(slot);
+	else word.strong &= ~get_mask(slot);
+	invalidate_period();
+}
+
+void Engine::get_lanes(Index index, uint64_t& powered, uint64_t& strong) const
+{
+	assert(mode == Mode::Batch);
+	const StateWord& word = lanes[wire_slots[index]];
+	powered = word.powered;
+	strong = word.strong;
 }
 
 void Engine::tick(uint32_t count)
 {
-	for (size_t i = 0; i < count; ++i)
+	execute(count, false);
+}
+
+uint32_t Engine::settle(uint32_t max_count)
+{
+	return execute(max_count, true);
+}
+
+uint8_t Engine::get_state(Index index) const
+{
+	Index slot = wire_slots[index];
+	const StateWord& word = states[get_word(slot)];
+	uint8_t powered = (word.powered & get_mask(slot)) != 0;
+	uint8_t strong = (word.strong & get_mask(slot)) != 0;
+	return powered | strong << 1;
+}
+
+void Engine::get_states(const void*& data, size_t& size) const
+{
+	data = states.data();
+	size = states.size() * sizeof(StateWord);
+}
+
+void Engine::get_slots(const void*& data, size_t& size) const
+{
+	static_assert(sizeof(Index) == sizeof(uint32_t));
+	data = wire_slots.data();
+	size = wire_slots.size() * sizeof(Index);
+}
+
+bool Engine::evaluate_gate(size_t index) const
+{
+	bool transistor = kernel_transistors[index] != 0;
+	uint8_t powered = 1;
+
+	for (const auto& inputs : kernel_inputs)
+	{
+		uint32_t input = inputs[index];
+		uint8_t state = 1;
+
+		if (input != KernelHighSlot)
+		{
+			Index slot(input - WordSize);
+			const StateWord& word = states[get_word(slot)];
+			state = ((word.powered | word.strong) & get_mask(slot)) != 0;
+		}
+
+		if (transistor) powered &= state;
+		else powered ^= state;
+	}
+
+	return powered != 0;
+}
+
+Index Engine::get_slot(Index wire) const
+{
+	if (not wire.valid()) return {};
+	assert(wire < wire_slots.size());
+	return wire_slots[wire];
+}
+
+void Engine::compile_kernel()
+{
+	std::vector<uint32_t> order = reorder();
+
+	kernel_outputs.clear();
+	kernel_transistors.clear();
+	for (auto& inputs : kernel_inputs) inputs.clear();
+
+	for (uint32_t gate : order)
 	{
-		for (size_t j = 0; j < states.size(); ++j)
+		kernel_outputs.push_back(get_slot(gates_output[gate]));
+		kernel_transistors.push_back(gates_transistor[gate] ? ~uint32_t(0) : 0);
+
+		for (size_t k = 0; k < kernel_inputs.size(); ++k)
 		{
-			states_next[j] = states[j] & 0b10;
+			Index input = get_slot(gates_inputs[gate][k]);
+			kernel_inputs[k].push_back(input.valid() ? input + WordSize : KernelHighSlot);
 		}
+	}
+
+	kernel_dirty = false;
+	events_dirty = true;
+}
+
+std::vector<uint32_t> Engine::reorder()
+{
+	size_t slot_count = slot_wires.size();
+	size_t gate_count = gates_output.size();
+
+	auto is_live = [this](size_t gate) { return get_slot(gates_output[gate]).valid(); };
+
+	auto for_each_slot = [this](size_t gate, auto action)
+	{
+		action(get_slot(gates_output[gate]));
 
-		for (size_t j = 0; j < gates_output.size(); ++j)
+		for (Index input : gates_inputs[gate])
 		{
-			Index output = gates_output[j];
-			if (not output.valid()) continue;
+			Index slot = get_slot(input);
+			if (slot.valid()) action(slot);
+		}
+	};
+
+	//Build the index of gates connected to each wire, either as an output or as an input
+	std::vector<uint32_t> offsets(slot_count + 1, 0);
+	std::vector<uint32_t> connected;
+
+	for (size_t j = 0; j < gate_count; ++j)
+	{
+		if (not is_live(j)) continue;
+		for_each_slot(j, [&offsets](Index slot) { ++offsets[slot + 1]; });
+	}
+
+	for (size_t j = 0; j < slot_count; ++j) offsets[j + 1] += offsets[j];
+	connected.resize(offsets.back());
+
+	{
+		std::vector<uint32_t> heads(offsets.begin(), offsets.end() - 1);
+
+		for (size_t j = 0; j < gate_count; ++j)
+		{
+			if (not is_live(j)) continue;
+			for_each_slot(j, [&](Index slot) { connected[heads[slot]++] = static_cast<uint32_t>(j); });
+		}
+	}
+
+	//Visit gates in breadth first order, assigning new slots to wires as they are first reached
+	std::vector<uint32_t> order;
+	std::vector<uint8_t> visited(gate_count, 0);
+	std::vector<Index> new_slots(slot_count);
+	uint32_t next_slot = 0;
 
-			bool transistor = gates_transistor[j] != 0;
-			uint8_t powered = 1;
+	for (size_t start = 0; start < gate_count; ++start)
+	{
+		if (visited[start] || not is_live(start)) continue;
+		visited[start] = 1;
+		order.push_back(static_cast<uint32_t>(start));
 
-			for (Index input : gates_inputs[j])
+		for (size_t head = order.size() - 1; head < order.size(); ++head)
+		{
+			for_each_slot(order[head], [&](Index slot)
 			{
-				uint8_t state = 1;
-				if (input.valid()) state = states[input] != 0;
+				if (new_slots[slot].valid()) return;
+				new_slots[slot] = Index(next_slot++);
 
-				if (transistor) powered &= state;
-				else powered ^= state;
-			}
+				for (uint32_t j = offsets[slot]; j < offsets[slot + 1]; ++j)
+				{
+					uint32_t gate = connected[j];
+					if (visited[gate]) continue;
+					visited[gate] = 1;
+					order.push_back(gate);
+				}
+			});
+		}
+	}
+
+	//Wires not connected to any gate keep their relative order at the end, while free slots are dropped
+	bool identity = free_slots.empty();
+
+	for (size_t slot = 0; slot < slot_count; ++slot)
+	{
+		if (not new_slots[slot].valid() && slot_wires[slot].valid()) new_slots[slot] = Index(next_slot++);
+		identity = identity && new_slots[slot] == slot;
+	}
+
+	if (identity) return order;
+
+	//Move the states and update all references to the slots
+	std::vector<Index> new_slot_wires(next_slot);
+	std::vector<StateWord> new_states((next_slot + WordSize - 1) / WordSize);
+
+	for (size_t slot = 0; slot < slot_count; ++slot)
+	{
+		Index target = new_slots[slot];
+		if (not target.valid()) continue;
+
+		const StateWord& word = states[get_word(Index(slot))];
+		uint64_t mask = get_mask(Index(slot));
+
+		StateWord& next = new_states[get_word(target)];
+		if (word.powered & mask) next.powered |= get_mask(target);
+		if (word.strong & mask) next.strong |= get_mask(target);
+		new_slot_wires[target] = slot_wires[slot];
+	}
+
+	if (not lanes.empty())
+	{
+		std::vector<StateWord> new_lanes(next_slot);
+
+		for (size_t slot = 0; slot < slot_count; ++slot)
+		{
+			Index target = new_slots[slot];
+			if (target.valid()) new_lanes[target] = lanes[slot];
+		}
+
+		lanes = std::move(new_lanes);
+	}
+
+	states = std::move(new_states);
+	states_next.resize(states.size());
+	slot_wires = std::move(new_slot_wires);
+	free_slots.clear();
+
+	for (Index& slot : wire_slots) if (slot.valid()) slot = new_slots[slot];
+	++slots_version;
+
+	return order;
+}
+
+namespace
+{
+
+struct KernelArguments
+{
+	const uint32_t* outputs;
+	std::array<const uint32_t*, 3> inputs;
+	const uint32_t* transistors;
+	const uint64_t* states;
+	uint64_t* powered;
+	size_t stride;
+};
+
+void evaluate_kernel_scalar(const KernelArguments& arguments, size_t begin, size_t end)
+{
+	auto read = [&arguments](uint32_t slot) -> uint32_t { return arguments.states[slot >> 6] >> (slot & 63) & 1; };
+
+	for (size_t j = begin; j < end; ++j)
+	{
+		uint32_t state0 = read(arguments.inputs[0][j]);
+		uint32_t state1 = read(arguments.inputs[1][j]);
+		uint32_t state2 = read(arguments.inputs[2][j]);
+
+		uint32_t transistor = arguments.transistors[j];
+		uint32_t powered_and = state0 & state1 & state2;
+		uint32_t powered_xnor = 1 ^ state0 ^ state1 ^ state2;
+		uint64_t powered = (transistor & powered_and) | (~transistor & powered_xnor);
+
+		uint32_t output = arguments.outputs[j];
+		arguments.powered[(output >> 6) * arguments.stride] |= powered << (output & 63);
+	}
+}
+
+#ifdef KERNEL_AVX2
+
+TARGET_AVX2
+__m256i read_avx2(const uint32_t* inputs, const int* words)
+{
+	__m256i slots = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs));
+	__m256i gathered = _mm256_i32gather_epi32(words, _mm256_srli_epi32(slots, 5), 4);
+	__m256i shifts = _mm256_and_si256(slots, _mm256_set1_epi32(31));
+	return _mm256_and_si256(_mm256_srlv_epi32(gathered, shifts), _mm256_set1_epi32(1));
+}
+
+TARGET_AVX2
+void evaluate_kernel_avx2(const KernelArguments& arguments, size_t begin, size_t end)
+{
+	constexpr size_t Width = 8;
+	const __m256i one = _mm256_set1_epi32(1);
+	const auto* words = reinterpret_cast<const int*>(arguments.states); //Little endian 32 bit view of the states
+
+	size_t j = begin;
+
+	for (; j + Width <= end; j += Width)
+	{
+		__m256i state0 = read_avx2(arguments.inputs[0] + j, words);
+		__m256i state1 = read_avx2(arguments.inputs[1] + j, words);
+		__m256i state2 = read_avx2(arguments.inputs[2] + j, words);
+
+		auto* pointer = reinterpret_cast<const __m256i*>(arguments.transistors + j);
+		__m256i transistor = _mm256_loadu_si256(pointer);
+		__m256i powered_and = _mm256_and_si256(_mm256_and_si256(state0, state1), state2);
+		__m256i powered_xnor = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(state0, state1), state2), one);
+		__m256i powered = _mm256_blendv_epi8(powered_xnor, powered_and, transistor);
+
+		//There is no scatter in AVX2, so only write the outputs that are powered
+		auto mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(powered, 31))));
+
+		for (; mask != 0; mask &= mask - 1)
+		{
+			uint32_t output = arguments.outputs[j + std::countr_zero(mask)];
+			arguments.powered[(output >> 6) * arguments.stride] |= uint64_t(1) << (output & 63);
+		}
+	}
+
+	evaluate_kernel_scalar(arguments, j, end);
+}
+
+bool supports_avx2()
+{
+#ifdef _MSC_VER
+	std::array<int, 4> info{};
+	__cpuid(info.data(), 0);
+	if (info[0] < 7) return false;
+
+	//Check for both CPU and OS support of AVX
+	__cpuid(info.data(), 1);
+	bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+	if (not avx || (_xgetbv(0) & 0b110) != 0b110) return false;
+
+	__cpuidex(info.data(), 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+}
+
+void Engine::evaluate_kernel(size_t begin, size_t end, uint64_t* powered, size_t stride) const
+{
+	using Function = void (*)(const KernelArguments&, size_t, size_t);
+
+#ifdef KERNEL_AVX2
+	static const bool avx2 = supports_avx2();
+	Function function = vectorized && avx2 ? evaluate_kernel_avx2 : evaluate_kernel_scalar;
+#else
+	Function function = evaluate_kernel_scalar;
+#endif
 
-			states_next[output] |= powered;
+	KernelArguments arguments{
+		kernel_outputs.data(),
+		{ kernel_inputs[0].data(), kernel_inputs[1].data(), kernel_inputs[2].data() },
+		kernel_transistors.data(), effective_states.data(), powered, stride
+	};
+
+	function(arguments, begin, end);
+}
+
+uint32_t Engine::execute(uint32_t count, bool until_stable)
+{
+	if (kernel_dirty) compile_kernel();
+	if (period_detection && period_dirty) reset_period();
+
+	uint32_t performed = 0;
+	uint32_t skipped = 0;
+
+	while (true)
+	{
+		//Skip whole periods since they always arrive back at the same states; a settle only skips if the states are never stable
+		if (period > 1 || (period == 1 && not until_stable))
+		{
+			uint32_t skipping = (count - performed) / period * period;
+			skipped += skipping;
+			count -= skipping;
+		}
+
+		if (performed == count) break;
+
+		if (mode == Mode::Parallel)
+		{
+			performed += tick_parallel(count - performed, until_stable);
+			if (until_stable && changed_words == 0) break;
+			if (period_detection) record_period();
+			continue;
+		}
+
+		if (mode == Mode::Sweep) tick_sweep();
+		else if (mode == Mode::Batch) tick_batch();
+		else if (events_dirty) tick_rebuild();
+		else tick_event();
+
+		++performed;
+		if (until_stable && changed_words == 0) break;
+		if (period_detection && mode != Mode::Batch) record_period();
+	}
+
+	return performed + skipped;
+}
+
+void Engine::tick_sweep()
+{
+	effective_states.resize(states.size() + 1);
+	effective_states[0] = ~uint64_t(0);
+
+	for (size_t j = 0; j < states.size(); ++j)
+	{
+		states_next[j].powered = 0;
+		states_next[j].strong = states[j].strong;
+		effective_states[j + 1] = states[j].powered | states[j].strong;
+	}
+
+	static_assert(sizeof(StateWord) == sizeof(uint64_t) * 2);
+	auto* powered = reinterpret_cast<uint64_t*>(states_next.data());
+	evaluate_kernel(0, kernel_outputs.size(), powered, 2);
+
+	//The strong planes are left unchanged by ticks, so only the powered planes can differ
+	changed_words = 0;
+
+	for (size_t j = 0; j < states.size(); ++j)
+	{
+		uint64_t powered = states[j].powered;
+		uint64_t next = states_next[j].powered;
+		if (powered == next) continue;
+
+		++changed_words;
+		if (period_detection) states_hash ^= hash_word(powered, j) ^ hash_word(next, j);
+	}
+
+	std::swap(states, states_next);
+}
+
+void Engine::tick_batch()
+{
+	lanes_next.resize(lanes.size());
+	lanes_effective.resize(lanes.size() + WordSize);
+	std::fill_n(lanes_effective.begin(), WordSize, ~uint64_t(0));
+
+	for (size_t j = 0; j < lanes.size(); ++j)
+	{
+		lanes_next[j].powered = 0;
+		lanes_next[j].strong = lanes[j].strong;
+		lanes_effective[j + WordSize] = lanes[j].powered | lanes[j].strong;
+	}
+
+	//Each bit is a separate lane, so the same bitwise gate logic advances all lanes at once
+	for (size_t j = 0; j < kernel_outputs.size(); ++j)
+	{
+		uint64_t state0 = lanes_effective[kernel_inputs[0][j]];
+		uint64_t state1 = lanes_effective[kernel_inputs[1][j]];
+		uint64_t state2 = lanes_effective[kernel_inputs[2][j]];
+
+		uint64_t transistor = kernel_transistors[j] ? ~uint64_t(0) : 0;
+		uint64_t powered = (transistor & state0 & state1 & state2) | (~transistor & ~(state0 ^ state1 ^ state2));
+		lanes_next[kernel_outputs[j]].powered |= powered;
+	}
+
+	//Copy lane 0 back to the regular states, so they can be drawn and read as usual
+	changed_words = 0;
+	for (StateWord& word : states) word.powered = 0;
+
+	for (size_t j = 0; j < lanes.size(); ++j)
+	{
+		uint64_t powered = lanes_next[j].powered;
+		changed_words += powered != lanes[j].powered;
+		states[get_word(Index(j))].powered |= (powered & 1) << (j & (WordSize - 1));
+	}
+
+	std::swap(lanes, lanes_next);
+}
+
+void Engine::tick_event()
+{
+	//Queue all gates reading from a wire that changed
+	for (Index wire : dirty_wires)
+	{
+		dirty_wires_mask[get_word(wire)] &= ~get_mask(wire);
+
+		for (uint32_t j = fanout_offsets[wire]; j < fanout_offsets[wire + 1]; ++j)
+		{
+			Index gate = fanout_gates[j];
+			if (gates_queued[gate]) continue;
+			gates_queued[gate] = 1;
+			queued_gates.push_back(gate);
 		}
+	}
+
+	dirty_wires.clear();
+
+	//Evaluate queued gates; since states are not modified here, all gates see the states from the previous tick
+	for (Index gate : queued_gates)
+	{
+		gates_queued[gate] = 0;
+
+		uint8_t powered = evaluate_gate(gate) ? 1 : 0;
+		if (powered == gates_powered[gate]) continue;
+		gates_powered[gate] = powered;
+
+		Index output(kernel_outputs[gate]);
+		if (powered) ++wires_drivers[output];
+		else --wires_drivers[output];
+
+		uint64_t& mask = touched_wires_mask[get_word(output)];
+		if (mask & get_mask(output)) continue;
+		mask |= get_mask(output);
+		touched_wires.push_back(output);
+	}
+
+	queued_gates.clear();
+
+	//Apply new states to wires with changed drivers
+	changed_words = 0;
+
+	for (Index wire : touched_wires)
+	{
+		touched_wires_mask[get_word(wire)] &= ~get_mask(wire);
+
+		StateWord& word = states[get_word(wire)];
+		uint64_t mask = get_mask(wire);
+		bool powered = wires_drivers[wire] > 0;
+		if (powered == ((word.powered & mask) != 0)) continue;
+
+		if (period_detection) states_hash ^= hash_word(word.powered, get_word(wire)) ^ hash_word(word.powered ^ mask, get_word(wire));
+		word.powered ^= mask;
+		++changed_words;
+		if (not(word.strong & mask)) mark_dirty_wire(wire);
+	}
+
+	touched_wires.clear();
+}
+
+uint32_t Engine::tick_parallel(uint32_t count, bool until_stable)
+{
+	if (count == 0) return 0;
+	if (thread_pool == nullptr || thread_pool->size() != thread_count) thread_pool = std::make_shared<ThreadPool>(thread_count);
+
+	uint32_t threads = thread_pool->size();
+	partial_powered.resize(threads);
+	partial_changed.assign(threads, 0);
+	partial_hashes.assign(threads, 0);
+	for (auto& partial : partial_powered) partial.assign(states.size(), 0);
+
+	effective_states.resize(states.size() + 1);
+	effective_states[0] = ~uint64_t(0);
+	for (size_t j = 0; j < states.size(); ++j) effective_states[j + 1] = states[j].powered | states[j].strong;
+
+	auto get_range = [threads](size_t size, uint32_t thread)
+	{
+		return std::make_pair(size * thread / threads, size * (thread + 1) / threads);
+	};
+
+	uint32_t performed = 0;
+	bool stopped = false;
 
+	//Recording the period can allocate, which cannot happen on the workers, so with period detection
+	//every tick stops here and lets execute record the period on the calling thread
+	auto complete = [&]() noexcept
+	{
 		std::swap(states, states_next);
+		changed_words = 0;
+		for (size_t changed : partial_changed) changed_words += changed;
+		for (uint64_t hash : partial_hashes) states_hash ^= hash;
+
+		++performed;
+		bool stable = until_stable && changed_words == 0;
+		stopped = stable || period_detection || performed == count;
+	};
+
+	std::barrier evaluated(threads);
+	std::barrier merged(threads, complete);
+
+	auto job = [&](uint32_t thread)
+	{
+		auto [gate_begin, gate_end] = get_range(kernel_outputs.size(), thread);
+		auto [word_begin, word_end] = get_range(states.size(), thread);
+		std::vector<uint64_t>& partial = partial_powered[thread];
+
+		while (true)
+		{
+			//Evaluate gates in the range of this thread to its own partial powered plane
+			evaluate_kernel(gate_begin, gate_end, partial.data(), 1);
+			evaluated.arrive_and_wait();
+
+			//Merge the partial planes of all threads for the words in the range of this thread
+			//Since OR is order independent, the result does not depend on the thread count or scheduling
+			size_t changed = 0;
+			uint64_t hash = 0;
+
+			for (size_t j = word_begin; j < word_end; ++j)
+			{
+				uint64_t powered = 0;
+
+				for (auto& other : partial_powered)
+				{
+					powered |= other[j];
+					other[j] = 0;
+				}
+
+				uint64_t strong = states[j].strong;
+				uint64_t old_powered = states[j].powered;
+
+				if (powered != old_powered)
+				{
+					++changed;
+					if (period_detection) hash ^= hash_word(old_powered, j) ^ hash_word(powered, j);
+				}
+
+				states_next[j].powered = powered;
+				states_next[j].strong = strong;
+				effective_states[j + 1] = powered | strong;
+			}
+
+			partial_changed[thread] = changed;
+			partial_hashes[thread] = hash;
+			merged.arrive_and_wait();
+			if (stopped) break;
+		}
+	};
+
+	thread_pool->run(job);
+	return performed;
+}
+
+void Engine::tick_rebuild()
+{
+	size_t wire_count = states.size() * WordSize;
+	size_t gate_count = kernel_outputs.size();
+
+	//Build fanout index
+	fanout_offsets.assign(wire_count + 1, 0);
+	fanout_gates.clear();
+
+	auto for_each_input = [this](size_t gate, auto action)
+	{
+		std::array<uint32_t, 3> inputs{};
+		for (size_t j = 0; j < inputs.size(); ++j) inputs[j] = kernel_inputs[j][gate];
+
+		for (size_t j = 0; j < inputs.size(); ++j)
+		{
+			uint32_t input = inputs[j];
+			if (input == KernelHighSlot) continue;
+			if (std::find(inputs.begin(), inputs.begin() + j, input) != inputs.begin() + j) continue;
+			action(Index(input - WordSize));
+		}
+	};
+
+	for (size_t j = 0; j < gate_count; ++j) for_each_input(j, [this](Index input) { ++fanout_offsets[input + 1]; });
+	for (size_t j = 0; j < wire_count; ++j) fanout_offsets[j + 1] += fanout_offsets[j];
+
+	{
+		std::vector<uint32_t> heads(fanout_offsets.begin(), fanout_offsets.end() - 1);
+		fanout_gates.resize(fanout_offsets.back());
+
+		for (size_t j = 0; j < gate_count; ++j)
+		{
+			auto insert = [this, j, &heads](Index input) { fanout_gates[heads[input]++] = Index(j); };
+			for_each_input(j, insert);
+		}
+	}
+
+	//Perform a sweep tick while recording gate outputs
+	wires_drivers.assign(wire_count, 0);
+	gates_powered.assign(gate_count, 0);
+	gates_queued.assign(gate_count, 0);
+
+	for (size_t j = 0; j < states.size(); ++j)
+	{
+		states_next[j].powered = 0;
+		states_next[j].strong = states[j].strong;
+	}
+
+	for (size_t j = 0; j < gate_count; ++j)
+	{
+		if (not evaluate_gate(j)) continue;
+		Index output(kernel_outputs[j]);
+
+		gates_powered[j] = 1;
+		++wires_drivers[output];
+		states_next[get_word(output)].powered |= get_mask(output);
+	}
+
+	//Mark all wires that changed as dirty
+	dirty_wires.clear();
+	dirty_wires_mask.assign(states.size(), 0);
+	touched_wires.clear();
+	touched_wires_mask.assign(states.size(), 0);
+	queued_gates.clear();
+
+	changed_words = 0;
+
+	for (size_t j = 0; j < states.size(); ++j)
+	{
+		const StateWord& word = states[j];
+		const StateWord& next = states_next[j];
+		uint64_t changed = (word.powered | word.strong) ^ (next.powered | next.strong);
+
+		if (word.powered != next.powered)
+		{
+			++changed_words;
+			if (period_detection) states_hash ^= hash_word(word.powered, j) ^ hash_word(next.powered, j);
+		}
+
+		for (; changed != 0; changed &= changed - 1)
+		{
+			auto bit = static_cast<uint32_t>(std::countr_zero(changed));
+			mark_dirty_wire(Index(static_cast<uint32_t>(j * WordSize + bit)));
+		}
 	}
+
+	std::swap(states, states_next);
+	events_dirty = false;
 }
 
-void Engine::get_states(const void*& data, size_t& size) const
+void Engine::invalidate_period()
 {
-	data = states.data();
-	size = states.size();
+	period_dirty = true;
+	period = 0;
+}
+
+void Engine::reset_period()
+{
+	states_hash = 0;
+	for (size_t j = 0; j < states.size(); ++j) states_hash ^= hash_word(states[j].powered, j);
+
+	period = 0;
+	period_ticks = 0;
+	period_history.clear();
+	period_history.emplace(states_hash, period_ticks);
+
+	candidate_period = 0;
+	candidate_powered.clear();
+	period_dirty = false;
+}
+
+void Engine::record_period()
+{
+	++period_ticks;
+	if (period != 0) return;
+
+	if (candidate_period != 0)
+	{
+		if (--candidate_remain > 0) return;
+
+		//The states are exactly periodic if they are the same as the copy made one candidate period ago
+		bool repeated = true;
+
+		for (size_t j = 0; j < states.size() && repeated; ++j) repeated = states[j].powered == candidate_powered[j];
+
+		if (repeated) period = candidate_period;
+		candidate_period = 0;
+		return;
+	}
+
+	if (period_history.size() >= PeriodHistoryLimit) period_history.clear();
+	auto [iterator, inserted] = period_history.try_emplace(states_hash, period_ticks);
+	if (inserted) return;
+
+	//The same hash was seen before, so the states likely repeat; verify it with an exact copy
+	candidate_period = static_cast<uint32_t>(period_ticks - iterator->second);
+	candidate_remain = candidate_period;
+	iterator->second = period_ticks;
+
+	candidate_powered.resize(states.size());
+	for (size_t j = 0; j < states.size(); ++j) candidate_powered[j] = states[j].powered;
+}
+
+void Engine::mark_dirty_wire(Index index)
+{
+	uint64_t& mask = dirty_wires_mask[get_word(index)];
+	if (mask & get_mask(index)) return;
+	mask |= get_mask(index);
+	dirty_wires.push_back(index);
+}
+
+uint32_t Engine::get_default_thread_count()
+{
+	return std::max(std::thread::hardware_concurrency(), 1u);
 }
 
 BinaryWriter& operator<<(BinaryWriter& writer, const Engine& engine)
 {
-	writer << engine.states;
-	writer << engine.gates_output;
-	writer << engine.gates_transistor;
-	writer << engine.gates_inputs;
+	//Serialize by wire and gate indices, so the internal layouts do not leak into the file format
+	using StateWord = Engine::StateWord;
+	std::vector<StateWord> states((engine.wire_slots.size() + Engine::WordSize - 1) / Engine::WordSize);
+
+	for (size_t j = 0; j < engine.wire_slots.size(); ++j)
+	{
+		Index slot = engine.wire_slots[j];
+		if (not slot.valid()) continue;
+
+		const StateWord& word = engine.states[Engine::get_word(slot)];
+		uint64_t mask = Engine::get_mask(slot);
+		StateWord& target = states[Engine::get_word(Index(j))];
+
+		if (word.powered & mask) target.powered |= Engine::get_mask(Index(j));
+		if (word.strong & mask) target.strong |= Engine::get_mask(Index(j));
+	}
+
+	size_t gate_count = engine.gates_internal.size();
+	std::vector<Index> gates_output(gate_count);
+	std::vector<uint8_t> gates_transistor(gate_count);
+	std::vector<std::array<Index, 3>> gates_inputs(gate_count);
+
+	for (size_t j = 0; j < engine.gates_external.size(); ++j)
+	{
+		Index index = engine.gates_external[j];
+		gates_output[index] = engine.gates_output[j];
+		gates_transistor[index] = engine.gates_transistor[j];
+		gates_inputs[index] = engine.gates_inputs[j];
+	}
+
+	writer << states;
+	writer << gates_output;
+	writer << gates_transistor;
+	writer << gates_inputs;
 	return writer;
 }
 
+void Engine::read_unpacked(BinaryReader& reader)
+{
+	assert(states.empty());
+	std::vector<uint8_t> bytes;
+	reader >> bytes;
+
+	//Each byte holds the same two bits as get_state
+	states.resize((bytes.size() + WordSize - 1) / WordSize);
+
+	for (size_t j = 0; j < bytes.size(); ++j)
+	{
+		Index index(static_cast<uint32_t>(j));
+		StateWord& word = states[get_word(index)];
+
+		if (bytes[j] & 0b01) word.powered |= get_mask(index);
+		if (bytes[j] & 0b10) word.strong |= get_mask(index);
+	}
+
+	read_gates(reader);
+}
+
+void Engine::read_gates(BinaryReader& reader)
+{
+	states_next.resize(states.size());
+
+	//Every wire starts with the state slot equal to its index
+	wire_slots.resize(states.size() * WordSize);
+	for (size_t j = 0; j < wire_slots.size(); ++j) wire_slots[j] = Index(j);
+	++slots_version;
+	slot_wires = wire_slots;
+
+	std::vector<Index> outputs;
+	std::vector<uint8_t> transistors;
+	std::vector<std::array<Index, 3>> inputs;
+
+	reader >> outputs;
+	reader >> transistors;
+	reader >> inputs;
+
+	//Gates start in index order; unregistered gates are indistinguishable from gates without output, so both are left out
+	gates_internal.assign(outputs.size(), Index());
+
+	for (size_t j = 0; j < outputs.size(); ++j)
+	{
+		if (not outputs[j].valid()) continue;
+
+		gates_internal[j] = Index(gates_output.size());
+		gates_external.push_back(Index(j));
+		gates_output.push_back(outputs[j]);
+		gates_transistor.push_back(transistors[j]);
+		gates_inputs.push_back(inputs[j]);
+	}
+}
+
 BinaryReader& operator>>(BinaryReader& reader, Engine& engine)
 {
 	assert(engine.states.empty());
 	reader >> engine.states;
-	engine.states_next.resize(engine.states.size());
-
-	reader >> engine.gates_output;
-	reader >> engine.gates_transistor;
-	reader >> engine.gates_inputs;
+	engine.read_gates(reader);
 	return reader;
 }
 
@@ -0,0 +1,108 @@
+#include "Functional/Board.hpp"
+#include "Functional/Tiles.hpp"
+#include "Functional/Drawing.hpp"
+
+namespace rw
+{
+
+void Layer::draw(DrawContext& context, Float2 min_position, Float2 max_position) const
+{
+	auto draw = [&context, this](Chunk& chunk)
+	{
+		chunk.update_draw_buffer(context, *this);
+		chunk.draw(context);
+	};
+
+	for_each_chunk(draw, Bounds(min_position, max_position));
+}
+
+void Layer::Chunk::draw(DrawContext& context) const
+{
+	if (vertex_buffer_quad != nullptr) context.draw(true, *vertex_buffer_quad);
+	if (vertex_buffer_wire != nullptr) context.draw(false, *vertex_buffer_wire);
+}
+
+void Layer::Chunk::update_draw_buffer(DrawContext& context, const Layer& layer)
+{
+	if (not vertices_dirty) return;
+	vertices_dirty = false;
+
+	for (Int2 position : Bounds(Int2(0), Int2(static_cast<int32_t>(Size))))
+	{
+		TileTag tile = get(position);
+		position += chunk_position * Size;
+
+		switch (tile.type.get_value())
+		{
+			case TileType::Wire:
+			{
+				Wire::draw(context, position, layer.find_wire(tile.index), layer);
+				break;
+			}
+			case TileType::Bridge:
+			{
+				Bridge::draw(context, position, tile.index, layer);
+				break;
+			}
+			case TileType::Gate:
+			{
+				Gate::draw(context, position, tile.index, layer);
+				break;
+			}
+			case TileType::None: continue;
+			default:
+			{
+				Float2 corner0(position);
+				Float2 corner1 = corner0 + Float2(1.0f);
+				context.emplace_quad(corner0, corner1, 0xFF00FFFF);
+				break;
+			}
+		}
+	}
+
+	vertex_buffer_quad = std::make_shared<VertexBuffer>(context.flush_buffer(true));
+	vertex_buffer_wire = std::make_shared<VertexBuffer>(context.flush_buffer(false));
+}
+
+void Wire::draw(DrawContext& context, Int2 position, Index index, const Layer& layer)
+{
+	auto corner0 = Float2(position);
+	Float2 corner1 = corner0 + Float2(1.0f);
+	context.emplace_wire(corner0, corner1, index);
+
+	//	const auto& wire = layer.get_list<Wire>()[index];
+	//	context.emplace_wire(corner0, corner1, wire.color);
+}
+
+void Bridge::draw(DrawContext& context, Int2 position, Index index, const Layer& layer)
+{
+	//	const auto& bridges = layer.get_list<Bridge>()[index];
+
+	auto corner0 = Float2(position);
+	Float2 corner1 = corner0 + Float2(1.0f);
+	context.emplace_quad(corner0, corner1, Color);
+}
+
+void Gate::draw(DrawContext& context, Int2 position, Index index, const Layer& layer)
+{
+	//Draw a little square to indicate rotation
+	constexpr float Extend = 0.15f;
+	constexpr float Offset = 0.5f - Extend;
+
+	const auto& gate = layer.get_list<Gate>()[index];
+	uint32_t color = gate.type == Type::Transistor ? ColorTransistor : ColorInverter;
+
+	auto corner0 = Float2(position);
+	Float2 corner1 = corner0 + Float2(1.0f);
+	context.emplace_quad(corner0, corner1, color);
+
+	Int2 direction = gate.rotation.get_direction();
+	Float2 origin = corner0 + Float2(0.5f);
+	Float2 center = origin + Float2(direction) * Offset;
+	corner0 = center - Float2(Extend);
+	corner1 = center + Float2(Extend);
+
+	context.emplace_quad(corner0, corner1, ColorDisabled);
+}
+
+}
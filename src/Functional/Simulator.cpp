@@ -0,0 +1,280 @@
+#include "Functional/Simulator.hpp"
+#include "Functional/Engine.hpp"
+
+namespace rw
+{
+
+Simulator::Access::Access(Simulator& simulator) : simulator(simulator)
+{
+	{
+		std::lock_guard lock(simulator.mutex);
+		++simulator.waiting_count;
+	}
+
+	simulator.engine_mutex.lock();
+
+	{
+		std::lock_guard lock(simulator.mutex);
+		--simulator.waiting_count;
+	}
+
+	simulator.perform_commands();
+}
+
+Simulator::Access::~Access()
+{
+	simulator.publish();
+
+	{
+		std::lock_guard lock(simulator.mutex);
+		simulator.progress.period = simulator.engine.get_period();
+		simulator.progress.stable = simulator.engine.is_stable();
+	}
+
+	simulator.engine_mutex.unlock();
+	simulator.condition.notify_one();
+}
+
+Simulator::Simulator(Engine& engine) : engine(engine)
+{
+	publish();
+	worker = std::thread(&Simulator::work, this);
+}
+
+Simulator::~Simulator()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+
+	condition.notify_one();
+	worker.join();
+}
+
+void Simulator::enqueue(std::function<void(Engine&)> command)
+{
+	{
+		std::lock_guard lock(mutex);
+		commands.push_back(std::move(command));
+	}
+
+	condition.notify_one();
+}
+
+void Simulator::request_ticks(uint64_t count, bool settle)
+{
+	{
+		std::lock_guard lock(mutex);
+		remain_count += count;
+		settling = settle;
+	}
+
+	condition.notify_one();
+}
+
+uint64_t Simulator::trim_ticks(uint64_t limit)
+{
+	std::lock_guard lock(mutex);
+	uint64_t dropping = remain_count > limit ? remain_count - limit : 0;
+	remain_count -= dropping;
+	return dropping;
+}
+
+void Simulator::set_continuous(bool enabled)
+{
+	{
+		std::lock_guard lock(mutex);
+		continuous = enabled;
+	}
+
+	condition.notify_one();
+}
+
+void Simulator::set_paused(bool enabled)
+{
+	{
+		std::lock_guard lock(mutex);
+		paused = enabled;
+	}
+
+	condition.notify_one();
+}
+
+void Simulator::set_time_budget(Duration budget)
+{
+	std::lock_guard lock(mutex);
+	time_budget = std::max(budget, Duration(1));
+}
+
+Simulator::Progress Simulator::collect()
+{
+	std::lock_guard lock(mutex);
+	Progress result = progress;
+	result.remain_count = remain_count;
+
+	progress.executed_count = 0;
+	progress.executed_duration = {};
+	return result;
+}
+
+const Simulator::Snapshot& Simulator::acquire_snapshot()
+{
+	if (middle_index.load(std::memory_order_relaxed) & FreshBit)
+	{
+		uint32_t index = middle_index.exchange(front_index, std::memory_order_acq_rel);
+		front_index = index & ~FreshBit;
+	}
+
+	const Snapshot& snapshot = buffers[front_index];
+	acquired_sequence.store(snapshot.sequence, std::memory_order_relaxed);
+	return snapshot;
+}
+
+void Simulator::work()
+{
+	using Clock = std::chrono::steady_clock;
+
+	while (true)
+	{
+		uint64_t count;
+		bool until_stable;
+		Duration budget;
+
+		{
+			std::unique_lock lock(mutex);
+
+			condition.wait(lock, [this]
+			{
+				if (stopping) return true;
+				if (waiting_count > 0) return false;
+				return not commands.empty() || (not paused && (continuous || remain_count > 0));
+			});
+
+			if (stopping) return;
+
+			if (paused) count = 0;
+			else if (continuous) count = std::numeric_limits<uint32_t>::max();
+			else count = remain_count;
+
+			until_stable = settling && not continuous;
+			budget = time_budget;
+		}
+
+		uint32_t performed = 0;
+		Duration elapsed{};
+		uint32_t period;
+		bool stable;
+
+		{
+			std::lock_guard engine_lock(engine_mutex);
+			perform_commands();
+
+			if (count > 0)
+			{
+				uint64_t attempt = budget / execute_rate;
+				attempt = std::clamp(attempt, uint64_t(1), std::min(count, uint64_t(std::numeric_limits<uint32_t>::max())));
+
+				auto start = Clock::now();
+
+				if (until_stable) performed = engine.settle(static_cast<uint32_t>(attempt));
+				else
+				{
+					engine.tick(static_cast<uint32_t>(attempt));
+					performed = static_cast<uint32_t>(attempt);
+				}
+
+				elapsed = std::chrono::duration_cast<Duration>(Clock::now() - start);
+			}
+
+			period = engine.get_period();
+			stable = engine.is_stable();
+			publish();
+		}
+
+		if (performed > 0) execute_rate = std::max(elapsed / performed, Duration(1));
+
+		std::lock_guard lock(mutex);
+		progress.executed_count += performed;
+		progress.executed_duration += elapsed;
+		progress.period = period;
+		progress.stable = stable;
+
+		if (not continuous) remain_count -= std::min(remain_count, uint64_t(performed));
+		if (until_stable && settling && stable) remain_count = 0;
+	}
+}
+
+void Simulator::perform_commands()
+{
+	std::vector<std::function<void(Engine&)>> queued;
+
+	{
+		std::lock_guard lock(mutex);
+		queued.swap(commands);
+	}
+
+	for (auto& command : queued) command(engine);
+}
+
+void Simulator::publish()
+{
+	static std::atomic<uint64_t> next_sequence = 1;
+	uint64_t sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+
+	const void* data;
+	size_t size;
+	engine.get_states(data, size);
+
+	const auto* words = static_cast<const uint64_t*>(data);
+	size_t count = size / sizeof(uint64_t);
+
+	//Find the changed pairs of words (powered and strong) by comparing against the previously published buffer
+	const Snapshot& previous = buffers[published_index];
+	Snapshot& snapshot = buffers[back_index];
+	word_sequences.resize(count / 2, sequence);
+
+	if (previous.states.size() == count)
+	{
+		for (size_t j = 0; j < count; j += 2)
+		{
+			if (words[j] == previous.states[j] && words[j + 1] == previous.states[j + 1]) continue;
+			word_sequences[j / 2] = sequence;
+		}
+	}
+	else std::fill(word_sequences.begin(), word_sequences.end(), sequence);
+
+	snapshot.states.assign(words, words + count);
+
+	//The state slots only change with edits or reordering, so they are shared between snapshots until then
+	snapshot.slots_version = engine.get_slots_version();
+
+	if (previous.slots != nullptr && previous.slots_version == snapshot.slots_version) snapshot.slots = previous.slots;
+	else
+	{
+		engine.get_slots(data, size);
+		const auto* slots = static_cast<const uint32_t*>(data);
+		snapshot.slots = std::make_shared<const std::vector<uint32_t>>(slots, slots + size / sizeof(uint32_t));
+	}
+
+	//Record the ranges changed since the last snapshot acquired by the reader, which it might not have uploaded yet
+	uint64_t base_sequence = acquired_sequence.load(std::memory_order_relaxed);
+	snapshot.sequence = sequence;
+	snapshot.base_sequence = base_sequence;
+	snapshot.changed.clear();
+
+	for (size_t j = 0; j < word_sequences.size(); ++j)
+	{
+		if (word_sequences[j] <= base_sequence) continue;
+		auto begin = static_cast<uint32_t>(j * 2);
+
+		if (snapshot.changed.empty() || snapshot.changed.back().end + RangeMergeGap < begin) snapshot.changed.push_back({ begin, begin + 2 });
+		else snapshot.changed.back().end = begin + 2;
+	}
+
+	published_index = back_index;
+	uint32_t index = middle_index.exchange(back_index | FreshBit, std::memory_order_acq_rel);
+	back_index = index & ~FreshBit;
+}
+
+}
@@ -1,11 +1,11 @@
 #include "Functional/Tiles.hpp"
 #include "Functional/Board.hpp"
 #include "Functional/Engine.hpp"
-#include "Functional/Drawing.hpp"
 #include "Utility/Functions.hpp"
 
 #include <random>
 #include <utility>
+#include <algorithm>
 
 namespace rw
 {
@@ -60,6 +60,7 @@ void Wire::insert(Layer& layer, Int2 position)
 	if (wire_index == Index())
 	{
 		wire_index = wires.emplace();
+		layer.register_wire(wire_index);
 		layer.get_engine().register_wire(wire_index);
 	}
 
@@ -97,6 +98,7 @@ void Wire::erase(Layer& layer, Int2 position)
 	if (wire.length() == 1)
 	{
 		wires.erase(tile.index);
+		layer.get_engine().unregister_wire(tile.index);
 		return;
 	}
 
@@ -108,14 +110,249 @@ void Wire::erase(Layer& layer, Int2 position)
 	if (neighbors.size() > 1) split_positions(layer, neighbors, tile.index);
 }
 
-void Wire::draw(DrawContext& context, Int2 position, Index index, const Layer& layer)
+void Wire::insert_line(Layer& layer, Int2 from, Int2 to, bool auto_bridge)
 {
-	auto corner0 = Float2(position);
-	Float2 corner1 = corner0 + Float2(1.0f);
-	context.emplace_wire(corner0, corner1, index);
+	assert(from.x == to.x || from.y == to.y);
+	Bounds line(from.min(to), from.max(to) + Int2(1));
+	Int2 other_axis = line.size().y == 1 ? Int2(0, 1) : Int2(1, 0);
 
-	//	const auto& wire = layer.get_list<Wire>()[index];
-	//	context.emplace_wire(corner0, corner1, wire.color);
+	//Bridges only depend on the tiles beside the line, so they can all be placed before the wires
+	if (auto_bridge)
+	{
+		for (Int2 current : line)
+		{
+			TileType type = layer.get(current).type;
+			if (type != TileType::None && type != TileType::Wire) continue;
+			if (not layer.has(current + other_axis, TileType::Wire) && not layer.has(current - other_axis, TileType::Wire)) continue;
+
+			if (type == TileType::Wire) erase(layer, current);
+			Bridge::insert(layer, current);
+		}
+	}
+
+	PositionSet positions;
+
+	for (Int2 current : line)
+	{
+		if (layer.has(current, TileType::None)) positions.insert(current);
+	}
+
+	insert_positions(layer, positions);
+}
+
+void Wire::insert_positions(Layer& layer, const PositionSet& positions)
+{
+	auto& wires = layer.get_list<Wire>();
+	PositionSet visited;
+	PositionSet gates;
+
+	std::vector<Int2> frontier;
+	std::vector<Int2> neighbors;
+
+	for (Int2 position : positions)
+	{
+		if (not visited.insert(position)) continue;
+		assert(layer.has(position, TileType::None));
+
+		//Find the connected group of new positions, along with its neighboring wires, bridges and gates
+		PositionSet group;
+		PositionSet bridges;
+		group.insert(position);
+		frontier.push_back(position);
+
+		do
+		{
+			Int2 current = frontier.back();
+			frontier.pop_back();
+
+			for (Int2 direction : FourDirections)
+			{
+				Int2 next = current + direction;
+
+				if (not positions.contains(next))
+				{
+					TileType type = layer.get(next).type;
+
+					if (type == TileType::Gate) gates.insert(next);
+					if (type != TileType::Bridge)
+					{
+						if (type == TileType::Wire) neighbors.push_back(next);
+						continue;
+					}
+
+					//Forward to the tile beyond the bridge
+					bridges.insert(next);
+					next += direction;
+
+					if (not positions.contains(next))
+					{
+						if (layer.has(next, TileType::Wire)) neighbors.push_back(next);
+						continue;
+					}
+				}
+
+				if (not visited.insert(next)) continue;
+				group.insert(next);
+				frontier.push_back(next);
+			}
+		}
+		while (not frontier.empty());
+
+		Index wire_index = merge_positions(layer, neighbors);
+		bool created = wire_index == Index();
+		neighbors.clear();
+
+		if (created)
+		{
+			wire_index = wires.emplace();
+			layer.register_wire(wire_index);
+			layer.get_engine().register_wire(wire_index);
+		}
+
+		//Assign the group to the wire
+		for (Int2 current : group) layer.set(current, TileTag(TileType::Wire, wire_index));
+
+		Wire& wire = wires[wire_index];
+
+		if (created)
+		{
+			//A new wire takes the sets as they are instead of copying them
+			wire.positions = std::move(group);
+			wire.bridges = std::move(bridges);
+		}
+		else
+		{
+			wire.positions.insert(group);
+			wire.bridges.insert(bridges);
+		}
+
+		assert(not wire.positions.intersects(wire.bridges));
+	}
+
+	for (Int2 position : gates) Gate::update(layer, position);
+}
+
+void Wire::erase_positions(Layer& layer, const PositionSet& positions, const PositionSet& bridges)
+{
+	auto& wires = layer.get_list<Wire>();
+	std::vector<Index> affected;
+	PositionSet gates;
+
+	//Clear the bridges first, while the wires next to them can still be found
+	for (Int2 position : bridges)
+	{
+		TileTag tile = layer.get(position);
+		assert(tile.type == TileType::Bridge);
+
+		layer.get_list<Bridge>().erase(tile.index);
+		layer.set(position, TileTag());
+
+		for (Int2 direction : FourDirections)
+		{
+			TileTag neighbor = layer.get(position + direction);
+			if (neighbor.type != TileType::Wire) continue;
+
+			wires[neighbor.index].bridges.erase(position);
+			affected.push_back(neighbor.index);
+		}
+	}
+
+	//Clear the wire tiles without splitting anything yet
+	for (Int2 position : positions)
+	{
+		TileTag tile = layer.get(position);
+		assert(tile.type == TileType::Wire);
+
+		bool erased = wires[tile.index].positions.erase(position);
+		assert(erased);
+		layer.set(position, TileTag());
+
+		if (affected.empty() || affected.back() != tile.index) affected.push_back(tile.index);
+
+		for (Int2 direction : FourDirections)
+		{
+			Int2 next = position + direction;
+			if (layer.has(next, TileType::Gate)) gates.insert(next);
+		}
+	}
+
+	std::sort(affected.begin(), affected.end());
+	affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+	PositionSet visited;
+	std::vector<Int2> frontier;
+	std::vector<PositionSet> sides;
+
+	for (Index wire_index : affected)
+	{
+		Wire& wire = wires[wire_index];
+		if (wire.positions.empty()) continue;
+
+		//Drop the bridges that no longer have a tile of this wire next to them
+		PositionSet disconnected;
+
+		for (Int2 bridge : wire.bridges)
+		{
+			auto is_neighbor = [&wire, bridge](Int2 direction) { return wire.positions.contains(bridge + direction); };
+			if (std::none_of(FourDirections.begin(), FourDirections.end(), is_neighbor)) disconnected.insert(bridge);
+		}
+
+		wire.bridges.erase(disconnected);
+
+		//Find the sides of what remains of the wire with one search over all of it
+		visited.clear();
+		sides.clear();
+
+		for (Int2 position : wire.positions)
+		{
+			if (not visited.insert(position)) continue;
+
+			PositionSet& side = sides.emplace_back();
+			side.insert(position);
+			frontier.push_back(position);
+
+			do
+			{
+				Int2 current = frontier.back();
+				frontier.pop_back();
+
+				for (Int2 direction : FourDirections)
+				{
+					Int2 next = current + direction;
+					if (wire.bridges.contains(next)) next += direction;
+					if (not wire.positions.contains(next) || not visited.insert(next)) continue;
+
+					side.insert(next);
+					frontier.push_back(next);
+				}
+			}
+			while (not frontier.empty());
+		}
+
+		if (sides.size() < 2) continue;
+
+		//The largest side keeps this wire, so the fewest tiles are moved
+		auto compare = [](const PositionSet& side, const PositionSet& other) { return side.size() < other.size(); };
+		auto largest = std::max_element(sides.begin(), sides.end(), compare);
+
+		for (auto iterator = sides.begin(); iterator != sides.end(); ++iterator)
+		{
+			if (iterator != largest) separate_positions(layer, wire_index, *iterator);
+		}
+	}
+
+	//Gates must stop referring to the emptied wires before those are unregistered
+	for (Int2 position : gates)
+	{
+		if (layer.has(position, TileType::Gate)) Gate::update(layer, position);
+	}
+
+	for (Index wire_index : affected)
+	{
+		if (not wires[wire_index].positions.empty()) continue;
+		wires.erase(wire_index);
+		layer.get_engine().unregister_wire(wire_index);
+	}
 }
 
 std::vector<Int2> Wire::get_neighbors(const Layer& layer, Int2 position, std::span<const Int2> directions)
@@ -228,20 +465,24 @@ Index Wire::merge_positions(Layer& layer, const std::vector<Int2>& positions)
 		TileTag tile = layer.get(position);
 		assert(tile.type == TileType::Wire);
 		if (tile.index == wire_index) continue;
-		const Wire& old_wire = wires[tile.index];
+		Wire& old_wire = wires[tile.index];
 
-		for (Int2 current : old_wire.positions)
-		{
-			layer.set(current, TileTag(TileType::Wire, wire_index));
-			update_neighbors_gates(layer, current);
-		}
+		//The tiles resolve to the merged wire through their component, so only the gates are updated
+		layer.merge_wire(tile.index, wire_index);
+		PositionSet gates = std::move(old_wire.gates);
 
 		//Union the two sets
-		wire.positions.insert(old_wire.positions.begin(), old_wire.positions.end());
-		wire.bridges.insert(old_wire.bridges.begin(), old_wire.bridges.end());
-		assert(set_intersect(wire.positions, wire.bridges).empty());
+		wire.positions.insert(old_wire.positions);
+		wire.bridges.insert(old_wire.bridges);
+		assert(not wire.positions.intersects(wire.bridges));
 
 		wires.erase(tile.index);
+		layer.get_engine().merge_wire(tile.index, wire_index);
+
+		for (Int2 current : gates)
+		{
+			if (layer.has(current, TileType::Gate)) Gate::update(layer, current);
+		}
 	}
 
 	return wire_index;
@@ -304,109 +545,128 @@ void Wire::split_positions(Layer& layer, std::vector<Int2>& positions, Index wir
 	wires.reserve(wires.size() + positions.size() - 1);
 	Wire& wire = wires[wire_index]; //Do NOT move this above the previous line!
 
-	//Initialize depth first search
-	std::vector<Int2> frontier;
-	std::unordered_set<Int2> visited;
-
-	frontier.push_back(positions.back());
-	visited.insert(positions.back());
-	positions.pop_back();
-
-	//Perform first search, tries to reach all neighbors
-	do
+	//Search from all positions at once, one tile per search in turn, and join searches as soon as they reach each other
+	//This stops once at most one search is left, so only the sides of the cut other than the largest one are fully visited
+	struct Search
 	{
-		Int2 current = frontier.back();
-		frontier.pop_back();
-
-		for (Int2 direction : FourDirections)
-		{
-			Int2 next = current + direction;
-			if (wire.bridges.contains(next)) next += direction;
-			if (not wire.positions.contains(next)) continue;
-			if (not visited.insert(next).second) continue;
+		std::vector<Int2> frontier;
+		PositionSet visited;
+		bool active = true;
+	};
 
-			//Immediately stop search if all neighbors are connected
-			auto iterator = std::find(positions.begin(), positions.end(), next);
-			if (iterator != positions.end() && (positions.erase(iterator), positions.empty())) return;
+	std::vector<Search> searches(positions.size());
+	size_t active_count = searches.size();
 
-			frontier.push_back(next);
-		}
+	for (size_t i = 0; i < searches.size(); ++i)
+	{
+		searches[i].frontier.push_back(positions[i]);
+		searches[i].visited.insert(positions[i]);
 	}
-	while (not frontier.empty());
-
-	visited.clear();
 
-	//The same wire no longer connects all positions, need to create new wires
-	std::unordered_set<Int2> bridges;
+	positions.clear();
 
-	do
+	auto find_other = [&searches](const Search& search, Int2 position) -> Search*
 	{
-		Index new_index = wires.emplace();
-		layer.get_engine().register_wire(new_index);
-
+		for (Search& other : searches)
 		{
-			Int2 current = positions.back();
-			positions.pop_back();
-
-			frontier.push_back(current);
-			visited.insert(current);
-			bool erased = wire.positions.erase(current);
-			assert(erased);
+			if (&other != &search && other.active && other.visited.contains(position)) return &other;
 		}
 
-		//Perform full search to change all connected tiles to this new wire
-		do
+		return nullptr;
+	};
+
+	while (active_count > 1)
+	{
+		for (Search& search : searches)
 		{
-			Int2 current = frontier.back();
-			frontier.pop_back();
+			if (not search.active) continue;
+
+			if (search.frontier.empty())
+			{
+				//Visited the whole side, which is now known to be disconnected from the others
+				search.active = false;
+				if (--active_count == 1) break;
+				continue;
+			}
 
-			layer.set(current, TileTag(TileType::Wire, new_index));
-			update_neighbors_gates(layer, current);
+			Int2 current = search.frontier.back();
+			search.frontier.pop_back();
 
 			for (Int2 direction : FourDirections)
 			{
 				Int2 next = current + direction;
+				if (wire.bridges.contains(next)) next += direction;
+				if (not wire.positions.contains(next)) continue;
+				if (search.visited.contains(next)) continue;
 
-				if (wire.bridges.erase(next))
+				if (Search* other = find_other(search, next))
 				{
-					assert(layer.has(next, TileType::Bridge));
-					Int2 rotated = direction;
-					std::swap(rotated.x, rotated.y);
-
-					//If this bridge is still used by this wire in some way, we place it back to allow passing through it once again
-					if (wire.positions.contains(next + rotated) || wire.positions.contains(next - rotated)) wire.bridges.insert(next);
+					//Both searches are on the same side, so they continue as one and the other is left empty
+					search.visited.insert(other->visited);
+					search.frontier.insert(search.frontier.end(), other->frontier.begin(), other->frontier.end());
 
-					assert(not visited.contains(next));
-					bridges.insert(next);
-					next += direction;
+					*other = Search{ {}, {}, false };
+					if (--active_count == 1) break;
+					continue;
 				}
 
-				if (not wire.positions.erase(next)) continue;
-				bool inserted = visited.insert(next).second;
-				assert(layer.has(next, TileType::Wire));
-				assert(inserted);
-
-				frontier.push_back(next);
+				search.visited.insert(next);
+				search.frontier.push_back(next);
 			}
+
+			if (active_count == 1) break;
 		}
-		while (not frontier.empty());
+	}
+
+	//Each exhausted side becomes a new wire, while the last side keeps this wire without being visited again
+	for (Search& search : searches)
+	{
+		if (search.active || search.visited.empty()) continue;
+		separate_positions(layer, wire_index, search.visited);
+	}
+}
+
+void Wire::separate_positions(Layer& layer, Index wire_index, PositionSet& positions)
+{
+	auto& wires = layer.get_list<Wire>();
+	Index new_index = wires.emplace();
+	layer.register_wire(new_index);
+	layer.get_engine().register_wire(new_index);
 
-		//Assign connected tiles to data
-		std::erase_if(positions, [&visited](Int2 current) { return visited.contains(current); });
+	Wire& wire = wires[wire_index]; //Fetched after the emplace, which can move the wires
+	PositionSet bridges;
+	wire.positions.erase(positions);
 
-		assert(set_intersect(visited, bridges).empty());
-		std::swap(wires[new_index].positions, visited);
-		std::swap(wires[new_index].bridges, bridges);
+	for (Int2 current : positions)
+	{
+		layer.set(current, TileTag(TileType::Wire, new_index));
+
+		for (Int2 direction : FourDirections)
+		{
+			Int2 next = current + direction;
+			if (wire.bridges.contains(next)) bridges.insert(next);
+
+			//Every gate next to a tile is connected to its wire, so only the gates of this wire need to be checked
+			if (wire.gates.contains(next) && layer.has(next, TileType::Gate)) Gate::update(layer, next);
+		}
+	}
 
-		assert(visited.empty());
-		assert(bridges.empty());
+	//A bridge stays in this wire only if this wire still has a tile next to it
+	for (Int2 bridge : bridges)
+	{
+		assert(layer.has(bridge, TileType::Bridge));
+		auto is_neighbor = [&wire, bridge](Int2 direction) { return wire.positions.contains(bridge + direction); };
+		if (std::none_of(FourDirections.begin(), FourDirections.end(), is_neighbor)) wire.bridges.erase(bridge);
 	}
-	while (not positions.empty());
+
+	assert(not positions.intersects(bridges));
+	wires[new_index].positions = std::move(positions);
+	wires[new_index].bridges = std::move(bridges);
 }
 
 BinaryWriter& operator<<(BinaryWriter& writer, const Wire& wire)
 {
-	auto write = [&writer](const std::unordered_set<Int2>& positions)
+	auto write = [&writer](const PositionSet& positions)
 	{
 		writer << static_cast<uint32_t>(positions.size());
 		for (Int2 position : positions) writer << position;
@@ -419,7 +679,7 @@ BinaryWriter& operator<<(BinaryWriter& writer, const Wire& wire)
 
 BinaryReader& operator>>(BinaryReader& reader, Wire& wire)
 {
-	auto read = [&reader](std::unordered_set<Int2>& positions)
+	auto read = [&reader](PositionSet& positions)
 	{
 		assert(positions.empty());
 		uint32_t size;
@@ -429,7 +689,7 @@ BinaryReader& operator>>(BinaryReader& reader, Wire& wire)
 		{
 			Int2 position;
 			reader >> position;
-			bool success = positions.insert(position).second;
+			bool success = positions.insert(position);
 			assert(success);
 		}
 	};
@@ -497,15 +757,6 @@ void Bridge::erase(Layer& layer, Int2 position)
 	Wire::split_positions(layer, neighbors);
 }
 
-void Bridge::draw(DrawContext& context, Int2 position, Index index, const Layer& layer)
-{
-	//	const auto& bridges = layer.get_list<Bridge>()[index];
-
-	auto corner0 = Float2(position);
-	Float2 corner1 = corner0 + Float2(1.0f);
-	context.emplace_quad(corner0, corner1, Color);
-}
-
 Gate::Gate(Gate::Type type, TileRotation rotation) : type(type), rotation(rotation)
 {
 	assert(type == Type::Transistor || type == Type::Inverter);
@@ -537,40 +788,23 @@ void Gate::erase(Layer& layer, Int2 position)
 	layer.get_engine().unregister_gate(tile.index);
 }
 
-void Gate::draw(DrawContext& context, Int2 position, Index index, const Layer& layer)
-{
-	//Draw a little square to indicate rotation
-	constexpr float Extend = 0.15f;
-	constexpr float Offset = 0.5f - Extend;
-
-	const auto& gate = layer.get_list<Gate>()[index];
-	uint32_t color = gate.type == Type::Transistor ? ColorTransistor : ColorInverter;
-
-	auto corner0 = Float2(position);
-	Float2 corner1 = corner0 + Float2(1.0f);
-	context.emplace_quad(corner0, corner1, color);
-
-	Int2 direction = gate.rotation.get_direction();
-	Float2 origin = corner0 + Float2(0.5f);
-	Float2 center = origin + Float2(direction) * Offset;
-	corner0 = center - Float2(Extend);
-	corner1 = center + Float2(Extend);
-
-	context.emplace_quad(corner0, corner1, ColorDisabled);
-}
-
 void Gate::update(Layer& layer, Int2 position)
 {
 	TileTag tile = layer.get(position);
 	assert(tile.type == TileType::Gate);
 	auto& gate = layer.get_list<Gate>()[tile.index];
 
+	auto& wires = layer.get_list<Wire>();
 	TileRotation rotation = gate.rotation;
 
 	for (Index& wire_index : gate.wire_indices)
 	{
 		TileTag neighbor = layer.get(position + rotation.get_direction());
-		wire_index = neighbor.type == TileType::Wire ? neighbor.index : Index();
+		Index new_index = neighbor.type == TileType::Wire ? neighbor.index : Index();
+
+		//A gate that was already connected to this wire is already in its gates
+		if (new_index.valid() && new_index != wire_index) wires[new_index].gates.insert(position);
+		wire_index = new_index;
 		rotation = rotation.get_next();
 	}
 
@@ -1,6 +1,7 @@
 #include "Interface/Application.hpp"
 #include "Interface/Components.hpp"
 #include "Functional/Board.hpp"
+#include "Functional/Drawing.hpp"
 
 #include "SFML/System.hpp"
 #include "SFML/Window.hpp"
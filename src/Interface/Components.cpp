@@ -2,6 +2,7 @@
 #include "Functional/Board.hpp"
 #include "Functional/Tiles.hpp"
 #include "Functional/Engine.hpp"
+#include "Functional/Simulator.hpp"
 #include "Functional/Drawing.hpp"
 #include "Utility/Functions.hpp"
 
@@ -22,6 +23,7 @@ Controller::Controller(Application& application) : Component(application) {}
 void Controller::initialize()
 {
 	layer = std::make_unique<Layer>();
+	simulator = std::make_unique<Simulator>(layer->get_engine());
 	std::string("test.rw2").copy(path_buffer.data(), path_buffer.size());
 }
 
@@ -48,7 +50,7 @@ static void save_layer(const fs::path& path, const std::unique_ptr<Layer>& layer
 	if (not stream->good()) throw std::runtime_error("Unable to open stream.");
 
 	BinaryWriter writer(stream);
-	writer << static_cast<uint32_t>(3);
+	writer << Layer::FileVersion;
 	writer << *layer << layer_view;
 }
 
@@ -60,10 +62,11 @@ static void load_layer(const fs::path& path, std::unique_ptr<Layer>& layer, Laye
 	BinaryReader reader(stream);
 	uint32_t version;
 	reader >> version;
-	if (version != 3) throw std::runtime_error("Unrecognized version.");
+	if (version < Layer::OldestFileVersion || version > Layer::FileVersion) throw std::runtime_error("Unrecognized version.");
 
 	layer = std::make_unique<Layer>();
-	reader >> *layer >> layer_view;
+	layer->read(reader, version);
+	reader >> layer_view;
 }
 
 static void new_layer(std::unique_ptr<Layer>& layer, LayerView& layer_view)
@@ -108,9 +111,22 @@ void Controller::update_interface()
 		{
 			auto& layer_view = *application.find_component<LayerView>();
 
-			if (selected_action == ActionType::Save) save_layer(path, layer, layer_view);
-			else if (selected_action == ActionType::Load) load_layer(path, layer, layer_view);
-			else if (selected_action == ActionType::New) new_layer(layer, layer_view);
+			if (selected_action == ActionType::Save)
+			{
+				auto access = simulator->lock();
+				save_layer(path, layer, layer_view);
+			}
+			else
+			{
+				//The simulation thread must stop before the engine it ticks is replaced
+				simulator.reset();
+
+				if (selected_action == ActionType::Load) load_layer(path, layer, layer_view);
+				else if (selected_action == ActionType::New) new_layer(layer, layer_view);
+
+				simulator = std::make_unique<Simulator>(layer->get_engine());
+				application.find_component<TickControl>()->reset_configuration();
+			}
 
 			selected_action = ActionType::None;
 		}
@@ -150,7 +166,8 @@ void LayerView::update()
 	}
 
 	draw_grid();
-	draw_layer(*layer);
+	draw_layer(*layer, controller->get_simulator()->acquire_snapshot());
+	uploaded_size = draw_context->take_uploaded_size();
 }
 
 void LayerView::input_event(const sf::Event& event)
@@ -248,14 +265,39 @@ void LayerView::draw_grid() const
 	window.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Lines);
 }
 
-void LayerView::draw_layer(const Layer& layer) const
+void LayerView::draw_layer(const Layer& layer, const Simulator::Snapshot& snapshot)
 {
 	draw_context->set_view(center, extend);
 
-	const void* states_data;
-	size_t states_size;
-	layer.get_engine().get_states(states_data, states_size);
-	draw_context->set_wire_states(states_data, states_size);
+	if (snapshot.sequence != uploaded_sequence)
+	{
+		const auto& states = snapshot.states;
+		size_t states_size = states.size() * sizeof(uint64_t);
+
+		//The changed ranges can only be used if they are based on the uploaded states
+		bool based = snapshot.base_sequence != 0 && snapshot.base_sequence <= uploaded_sequence;
+
+		if (based && states_size == uploaded_states_size)
+		{
+			for (Simulator::Range range : snapshot.changed)
+			{
+				size_t offset = range.begin * sizeof(uint64_t);
+				size_t size = (range.end - range.begin) * sizeof(uint64_t);
+				draw_context->update_wire_states(states.data() + range.begin, offset, size);
+			}
+		}
+		else draw_context->set_wire_states(states.data(), states_size);
+
+		uploaded_sequence = snapshot.sequence;
+		uploaded_states_size = states_size;
+	}
+
+	if (snapshot.slots != uploaded_slots)
+	{
+		const auto& slots = *snapshot.slots;
+		draw_context->set_wire_slots(slots.data(), slots.size() * sizeof(uint32_t));
+		uploaded_slots = snapshot.slots;
+	}
 
 	layer.draw(*draw_context, get_min(), get_max());
 	draw_context->clear();
@@ -420,7 +462,10 @@ void Cursor::Tool::update_mouse()
 		{
 			Layer* layer = cursor.controller->get_layer();
 			assert(layer != nullptr);
+
+			auto access = cursor.controller->get_simulator()->lock();
 			commit(*layer);
+			layer->compact();
 		}
 
 		drag_type = DragType::None;
@@ -489,7 +534,11 @@ void Cursor::MouseTool::update(Int2 position)
 	{
 		Layer* layer = cursor.controller->get_layer();
 		TileTag tile = layer->get(position);
-		if (tile.type == TileType::Wire) layer->get_engine().toggle_wire_strong_powered(tile.index);
+		if (tile.type != TileType::Wire) return;
+
+		Index index = tile.index;
+		auto toggle = [index](Engine& engine) { engine.toggle_wire_strong_powered(index); };
+		cursor.controller->get_simulator()->enqueue(toggle);
 	}
 }
 
@@ -514,39 +563,8 @@ void Cursor::WireTool::update(Int2 position)
 void Cursor::WireTool::commit(Layer& layer)
 {
 	bool horizontal = drag_type == DragType::Horizontal;
-	auto drag = horizontal ? std::make_pair(drag_origin.x, drag_position.x)
-	                       : std::make_pair(drag_origin.y, drag_position.y);
-
-	if (drag.first > drag.second) std::swap(drag.first, drag.second);
-	Int2 other_axis = horizontal ? Int2(0, 1) : Int2(1, 0);
-
-	for (int32_t i = drag.first; i <= drag.second; ++i)
-	{
-		Int2 current = horizontal ? Int2(i, drag_origin.y) : Int2(drag_origin.x, i);
-		TileType type = layer.get(current).type;
-
-		if (selected_auto_bridge)
-		{
-			if (type != TileType::None && type != TileType::Wire) continue;
-			bool bridge = layer.has(current + other_axis, TileType::Wire) ||
-			              layer.has(current - other_axis, TileType::Wire);
-
-			if (bridge)
-			{
-				if (type == TileType::Wire)
-				{
-					Wire::erase(layer, current);
-					type = TileType::None;
-				}
-
-				assert(type == TileType::None);
-				Bridge::insert(layer, current);
-				continue;
-			}
-		}
-
-		if (type == TileType::None) Wire::insert(layer, current);
-	}
+	Int2 drag_end = horizontal ? Int2(drag_position.x, drag_origin.y) : Int2(drag_origin.x, drag_position.y);
+	Wire::insert_line(layer, drag_origin, drag_end, selected_auto_bridge);
 }
 
 void Cursor::DeviceTool::update_interface()
@@ -796,9 +814,13 @@ void Cursor::ClipboardTool::commit(Layer& layer)
 
 		layer.erase(Bounds(min, max + size));
 
+		//Paste all copies together so their wires are connected in one pass
+		std::vector<Int2> positions;
 		(drag_type == DragType::Horizontal ? size.y : size.x) = 0;
-		do buffer->paste(min, layer);
+		do positions.push_back(min);
 		while ((min += size) <= max);
+
+		buffer->paste(positions, layer);
 	}
 	else
 	{
@@ -812,61 +834,9 @@ Cursor::ClipboardTool::Buffer::Buffer(const Layer& source, Bounds bounds) :
 	buffer(std::make_unique<Layer>(source.copy(bounds))),
 	bounds(bounds), rotation(TileRotation::Angle0) {}
 
-void Cursor::ClipboardTool::Buffer::paste(Int2 position, Layer& layer) const
+void Cursor::ClipboardTool::Buffer::paste(std::span<const Int2> positions, Layer& layer) const
 {
-	//Precalculate transformation parameters
-	Int2 one_less = size() - Int2(1);
-	Int2 multiplier = Int2(1);
-
-	if (rotation == TileRotation::Angle180 || rotation == TileRotation::Angle90)
-	{
-		multiplier.x = -1;
-		position.x += one_less.x;
-	}
-
-	if (rotation == TileRotation::Angle180 || rotation == TileRotation::Angle270)
-	{
-		multiplier.y = -1;
-		position.y += one_less.y;
-	}
-
-	//Insert new tiles to destination
-	for (Int2 current : bounds)
-	{
-		//Skip empty tiles
-		TileTag tile = buffer->get(current);
-		if (tile.type == TileType::None) continue;
-
-		//Transform current position based on rotation
-		Int2 offset = current - bounds.get_min();
-		if (rotation.vertical()) std::swap(offset.x, offset.y);
-		current = offset * multiplier + position;
-
-		if (not layer.has(current, TileType::None)) continue;
-
-		//Insert tile
-		switch (tile.type.get_value())
-		{
-			case TileType::Wire:
-			{
-				Wire::insert(layer, current);
-				break;
-			}
-			case TileType::Bridge:
-			{
-				Bridge::insert(layer, current);
-				break;
-			}
-			case TileType::Gate:
-			{
-				const Gate& gate = buffer->get_list<Gate>()[tile.index];
-				Gate::insert(layer, current, gate.get_type(), rotation.rotate(gate.get_rotation()));
-
-				break;
-			}
-			default: throw std::domain_error("Unrecognized TileType.");
-		}
-	}
+	layer.paste(*buffer, bounds, rotation, positions);
 }
 
 void Cursor::ClipboardTool::Buffer::draw(Int2 position, DrawContext& context, const LayerView& layer_view) const
@@ -883,8 +853,11 @@ void Cursor::ClipboardTool::Buffer::draw(Int2 position, DrawContext& context, co
 	Float2 min(bounds.get_min());
 	Float2 max(bounds.get_max());
 
+	//The copied wires have their own indices, which would read the states of unrelated wires
+	context.set_wires_unpowered(true);
 	context.clip(min, max);
 	buffer->draw(context, min, max);
+	context.set_wires_unpowered(false);
 	context.clear();
 }
 
@@ -916,6 +889,8 @@ void Debugger::update()
 		}
 	}
 
+	ImGui::LabelText("Uploaded Bytes", to_string(layer_view->get_uploaded_size()).c_str());
+
 	static int debug_wire = -1;
 	ImGui::InputInt("Debug Wire", &debug_wire);
 
@@ -981,7 +956,7 @@ void TickControl::update()
 	}
 
 	if (layer == nullptr) return;
-	update(layer->get_engine());
+	update(*controller->get_simulator());
 
 	if (not selected_pause) last_display_time += Timer::as_float(application.get_timer().frame_time());
 	if (last_display_time >= 1.0f) update_display();
@@ -1007,12 +982,14 @@ void TickControl::update_interface()
 		imgui_tooltip(
 			"How update ticks are triggered. Per Second = ticks are triggered consistently across every second, "
 			"Per Frame = ticks are triggered on every frame, Manual = ticks are triggered based on user input, "
-			"Maximum = as many ticks as possible are triggered continuously before responsiveness is degraded"
+			"Maximum = as many ticks as possible are triggered continuously on a separate thread"
 		);
 
 		if (selected_type != static_cast<Type>(old_type))
 		{
+			controller->get_simulator()->trim_ticks(0);
 			remain_count = 0;
+			settling = false;
 			dropped_count = 0;
 			per_second_error = 0.0f;
 			executed = {};
@@ -1020,13 +997,47 @@ void TickControl::update_interface()
 		}
 	}
 
+	{
+		static constexpr std::array Names = { "Sweep", "Event Driven", "Parallel", "Batch" };
+		int mode = static_cast<int>(selected_mode);
+		ImGui::Combo("Engine Type", &mode, Names.data(), Names.size());
+
+		imgui_tooltip(
+			"How ticks are simulated. Sweep = every gate is evaluated on every tick, "
+			"Event Driven = only gates with changed inputs are evaluated, which is faster for mostly idle circuits, "
+			"Parallel = every gate is evaluated on every tick using multiple threads, "
+			"Batch = every gate is evaluated on every tick for 64 independent lanes at once, where the first lane is shown"
+		);
+
+		if (selected_mode != static_cast<Engine::Mode>(mode))
+		{
+			selected_mode = static_cast<Engine::Mode>(mode);
+			executed = {};
+			update_display();
+		}
+	}
+
+	if (selected_mode == Engine::Mode::Parallel)
+	{
+		static constexpr uint32_t ThreadCountMin = 1;
+		static constexpr uint32_t ThreadCountMax = 256;
+		ImGui::DragScalar("Thread Count", ImGuiDataType_U32, &selected_thread_count, 0.1f, &ThreadCountMin, &ThreadCountMax);
+		selected_thread_count = std::clamp(selected_thread_count, ThreadCountMin, ThreadCountMax);
+		imgui_tooltip("The number of threads used to evaluate gates; results are identical regardless of this number");
+	}
+
+	{
+		ImGui::Checkbox("Detect Period", &selected_period_detection);
+		imgui_tooltip("Detect when the wires start repeating the same states, so whole periods can be skipped instead of simulated");
+	}
+
 	{
 		static constexpr uint32_t TimeBudgetMin = 1;
 		static constexpr uint32_t TimeBudgetMax = 100;
 		uint32_t budget = std::chrono::duration_cast<std::chrono::milliseconds>(time_budget).count();
 		ImGui::DragScalar("Time Budget", ImGuiDataType_U32, &budget, 1.0f, &TimeBudgetMin, &TimeBudgetMax, "%u ms");
 		time_budget = as_duration(std::clamp(budget, TimeBudgetMin, TimeBudgetMax));
-		imgui_tooltip("The time (in milliseconds) budgeted each frame for ticks; this may drastically affect responsiveness");
+		imgui_tooltip("The time (in milliseconds) the simulation thread ticks before showing the wires and applying edits; this may affect responsiveness");
 	}
 
 	if (selected_type != Type::Maximum)
@@ -1053,6 +1064,10 @@ void TickControl::update_interface()
 		if (ImGui::Button("Begin")) begin_manual();
 		imgui_tooltip("Manually trigger a target number of ticks. Can also activate with the [Space] button");
 
+		ImGui::SameLine();
+		if (ImGui::Button("Settle")) begin_settle();
+		imgui_tooltip("Trigger ticks until the wires stop changing, up to the target number of ticks");
+
 		ImGui::EndDisabled();
 	}
 
@@ -1090,6 +1105,19 @@ void TickControl::update_interface()
 		);
 	}
 
+	if (selected_period_detection)
+	{
+		std::string display = display_period == 0 ? "None" : std::to_string(display_period);
+		ImGui::LabelText("Period", display.c_str());
+		imgui_tooltip("Number of ticks after which the wires repeat the same states, detected since the last edit");
+	}
+
+	if (not display_settle_depth.empty())
+	{
+		ImGui::LabelText("Settle Depth", display_settle_depth.c_str());
+		imgui_tooltip("Number of ticks that changed any wire before the last settle reached a stable state");
+	}
+
 	if (selected_type == Type::Manual && remain_count + executed.count > 0)
 	{
 		auto total = static_cast<float>(remain_count + executed.count);
@@ -1137,8 +1165,33 @@ void TickControl::update_display()
 	}
 }
 
-void TickControl::update(Engine& engine)
+void TickControl::update(Simulator& simulator)
 {
+	if (not configured || configured_mode != selected_mode || configured_thread_count != selected_thread_count ||
+	    configured_period_detection != selected_period_detection)
+	{
+		auto configure = [mode = selected_mode, thread_count = selected_thread_count, period_detection = selected_period_detection](Engine& engine)
+		{
+			engine.set_mode(mode);
+			engine.set_thread_count(thread_count);
+			if (engine.get_period_detection() != period_detection) engine.set_period_detection(period_detection);
+		};
+
+		simulator.enqueue(configure);
+		configured = true;
+		configured_mode = selected_mode;
+		configured_thread_count = selected_thread_count;
+		configured_period_detection = selected_period_detection;
+	}
+
+	simulator.set_time_budget(time_budget);
+	simulator.set_paused(selected_pause);
+	simulator.set_continuous(selected_type == Type::Maximum);
+
+	Simulator::Progress progress = simulator.collect();
+	executed += TicksPair(progress.executed_duration, progress.executed_count);
+
+	display_period = progress.period;
 	if (selected_pause) return;
 
 	switch (selected_type)
@@ -1155,68 +1208,37 @@ void TickControl::update(Engine& engine)
 				++new_count;
 			}
 
-			remain_count = execute(engine, remain_count + new_count);
+			dropped_count += simulator.trim_ticks(new_count);
+			simulator.request_ticks(new_count);
 			per_second_error += count - static_cast<float>(new_count);
 
-			if (remain_count > new_count)
-			{
-				uint64_t dropping = remain_count - new_count;
-				dropped_count += dropping;
-				remain_count -= dropping;
-			}
-
 			break;
 		}
 		case Type::PerFrame:
 		{
-			dropped_count += execute(engine, selected_count);
+			dropped_count += simulator.trim_ticks(0);
+			simulator.request_ticks(selected_count);
 			break;
 		}
 		case Type::Manual:
 		{
 			uint64_t old_count = remain_count;
-			remain_count = execute(engine, remain_count);
-			if (remain_count == 0 && old_count != 0) update_display();
+			remain_count = progress.remain_count;
+			if (remain_count > 0 || old_count == 0) break;
 
-			break;
-		}
-		case Type::Maximum:
-		{
-			execute(engine, std::numeric_limits<uint32_t>::max());
-			break;
-		}
-	}
-}
-
-uint32_t TickControl::execute(Engine& engine, uint64_t count)
-{
-	assert(static_cast<uint32_t>(count) == count);
-	if (count == 0) return 0;
-
-	Duration budget = time_budget;
-	TicksPair total;
-
-	while (true)
-	{
-		auto attempt_budget = budget < as_duration(1) ? budget : budget / 2;
-		uint64_t attempt = attempt_budget / last_execute_rate;
-		attempt = std::clamp(attempt, uint64_t(1), count);
-
-		auto start = Clock::now();
-		engine.tick(static_cast<uint32_t>(attempt));
-
-		Duration elapsed = Clock::now() - start;
-		total += TicksPair(elapsed, attempt);
-		count -= attempt;
+			if (settling)
+			{
+				settling = false;
+				//Zero ticks never confirm that the states are stable
+				bool settled = progress.stable && executed.count > 0;
+				display_settle_depth = settled ? std::to_string(executed.count - 1) : "Not Settled";
+			}
 
-		if (count == 0 || elapsed >= budget) break;
-		budget -= elapsed;
+			update_display();
 
-		last_execute_rate = total.duration / total.count;
-		last_execute_rate = std::max(last_execute_rate, Duration(1));
+			break;
+		}
+		case Type::Maximum: break;
 	}
-
-	executed += total;
-	return count;
 }
 }
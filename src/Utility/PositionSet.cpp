@@ -0,0 +1,203 @@
+#include "Utility/PositionSet.hpp"
+
+#include <algorithm>
+
+namespace rw
+{
+
+bool PositionSet::contains(Int2 position) const
+{
+	uint32_t index = find(get_block_position(position));
+	if (index == Invalid) return false;
+
+	Int2 local = get_local_position(position);
+	return (blocks[index].rows[local.y] >> local.x & 1) != 0;
+}
+
+bool PositionSet::insert(Int2 position)
+{
+	uint32_t index = find_or_emplace(get_block_position(position));
+	Int2 local = get_local_position(position);
+
+	uint32_t& row = blocks[index].rows[local.y];
+	uint32_t mask = uint32_t(1) << local.x;
+	if (row & mask) return false;
+
+	row |= mask;
+	++count;
+	return true;
+}
+
+void PositionSet::insert(const PositionSet& other)
+{
+	for (const Block& block : other.blocks)
+	{
+		uint32_t index = find_or_emplace(block.position);
+		auto& rows = blocks[index].rows;
+
+		for (size_t i = 0; i < Size; ++i)
+		{
+			count += std::popcount(block.rows[i] & ~rows[i]);
+			rows[i] |= block.rows[i];
+		}
+	}
+}
+
+bool PositionSet::erase(Int2 position)
+{
+	uint32_t index = find(get_block_position(position));
+	if (index == Invalid) return false;
+
+	Int2 local = get_local_position(position);
+	auto& rows = blocks[index].rows;
+	uint32_t mask = uint32_t(1) << local.x;
+	if ((rows[local.y] & mask) == 0) return false;
+
+	rows[local.y] &= ~mask;
+	--count;
+
+	if (std::all_of(rows.begin(), rows.end(), [](uint32_t row) { return row == 0; })) erase_block(index);
+	return true;
+}
+
+void PositionSet::erase(const PositionSet& other)
+{
+	assert(&other != this);
+
+	for (const Block& block : other.blocks)
+	{
+		uint32_t index = find(block.position);
+		if (index == Invalid) continue;
+
+		auto& rows = blocks[index].rows;
+		bool empty = true;
+
+		for (size_t i = 0; i < Size; ++i)
+		{
+			count -= std::popcount(block.rows[i] & rows[i]);
+			rows[i] &= ~block.rows[i];
+			empty &= rows[i] == 0;
+		}
+
+		if (empty) erase_block(index);
+	}
+}
+
+void PositionSet::clear()
+{
+	blocks.clear();
+	table.clear();
+	count = 0;
+}
+
+bool PositionSet::intersects(const PositionSet& other) const
+{
+	const PositionSet* search = this;
+	const PositionSet* check = &other;
+	if (search->blocks.size() > check->blocks.size()) std::swap(search, check);
+
+	for (const Block& block : search->blocks)
+	{
+		uint32_t index = check->find(block.position);
+		if (index == Invalid) continue;
+
+		const auto& rows = check->blocks[index].rows;
+		for (size_t i = 0; i < Size; ++i) if (block.rows[i] & rows[i]) return true;
+	}
+
+	return false;
+}
+
+uint32_t PositionSet::find(Int2 block_position) const
+{
+	if (table.empty())
+	{
+		for (size_t i = 0; i < blocks.size(); ++i) if (blocks[i].position == block_position) return static_cast<uint32_t>(i);
+		return Invalid;
+	}
+
+	for (size_t slot = get_slot(block_position);; slot = (slot + 1) & (table.size() - 1))
+	{
+		uint32_t value = table[slot];
+		if (value == 0) return Invalid;
+		if (blocks[value - 1].position == block_position) return value - 1;
+	}
+}
+
+uint32_t PositionSet::find_or_emplace(Int2 block_position)
+{
+	uint32_t index = find(block_position);
+	if (index != Invalid) return index;
+
+	index = static_cast<uint32_t>(blocks.size());
+	blocks.push_back({ block_position });
+
+	//Keep the table at most half full, so the probe sequences stay short
+	if (blocks.size() <= TableThreshold) return index;
+	if (blocks.size() * 2 > table.size()) rebuild_table();
+	else
+	{
+		size_t slot = get_slot(block_position);
+		while (table[slot] != 0) slot = (slot + 1) & (table.size() - 1);
+		table[slot] = index + 1;
+	}
+
+	return index;
+}
+
+void PositionSet::erase_block(uint32_t index)
+{
+	auto last = static_cast<uint32_t>(blocks.size() - 1);
+
+	if (not table.empty())
+	{
+		//Remove the slot of the block, then shift back any later slot in the same cluster that can move closer to its home slot
+		size_t mask = table.size() - 1;
+		size_t slot = get_slot(blocks[index].position);
+		while (table[slot] != index + 1) slot = (slot + 1) & mask;
+
+		for (size_t next = (slot + 1) & mask; table[next] != 0; next = (next + 1) & mask)
+		{
+			size_t home = get_slot(blocks[table[next] - 1].position);
+			if (((next - home) & mask) < ((next - slot) & mask)) continue;
+
+			table[slot] = table[next];
+			slot = next;
+		}
+
+		table[slot] = 0;
+
+		//The last block is moved into the erased one, so its slot is redirected
+		if (index != last)
+		{
+			slot = get_slot(blocks[last].position);
+			while (table[slot] != last + 1) slot = (slot + 1) & mask;
+			table[slot] = index + 1;
+		}
+	}
+
+	if (index != last) blocks[index] = blocks[last];
+	blocks.pop_back();
+
+	if (blocks.size() <= TableThreshold) table.clear();
+}
+
+void PositionSet::rebuild_table()
+{
+	table.assign(std::bit_ceil(blocks.size() * 4), 0);
+	size_t mask = table.size() - 1;
+
+	for (size_t i = 0; i < blocks.size(); ++i)
+	{
+		size_t slot = get_slot(blocks[i].position);
+		while (table[slot] != 0) slot = (slot + 1) & mask;
+		table[slot] = static_cast<uint32_t>(i + 1);
+	}
+}
+
+size_t PositionSet::get_slot(Int2 block_position) const
+{
+	return std::hash<Int2>()(block_position) & (table.size() - 1);
+}
+
+}
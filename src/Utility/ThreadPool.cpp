@@ -0,0 +1,71 @@
+#include "Utility/ThreadPool.hpp"
+
+namespace rw
+{
+
+ThreadPool::ThreadPool(uint32_t count)
+{
+	assert(count > 0);
+	workers.reserve(count - 1);
+	for (uint32_t i = 1; i < count; ++i) workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+
+	start_condition.notify_all();
+	for (std::thread& worker : workers) worker.join();
+}
+
+void ThreadPool::run(const std::function<void(uint32_t)>& action)
+{
+	{
+		std::lock_guard lock(mutex);
+		assert(remain == 0);
+
+		job = &action;
+		remain = static_cast<uint32_t>(workers.size());
+		++generation;
+	}
+
+	start_condition.notify_all();
+	action(0);
+
+	std::unique_lock lock(mutex);
+	finish_condition.wait(lock, [this] { return remain == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::work(uint32_t index)
+{
+	uint64_t last_generation = 0;
+
+	while (true)
+	{
+		const std::function<void(uint32_t)>* action;
+
+		{
+			std::unique_lock lock(mutex);
+			start_condition.wait(lock, [this, last_generation] { return stopping || generation != last_generation; });
+			if (stopping) return;
+
+			last_generation = generation;
+			action = job;
+		}
+
+		(*action)(index);
+
+		{
+			std::lock_guard lock(mutex);
+			if (--remain > 0) continue;
+		}
+
+		finish_condition.notify_one();
+	}
+}
+
+}
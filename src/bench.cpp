@@ -0,0 +1,738 @@
+#include "Functional/Board.hpp"
+#include "Functional/Tiles.hpp"
+#include "Functional/Engine.hpp"
+
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+//The global allocation functions are replaced to track the heap, so the memory used by a circuit can be measured
+static std::atomic<size_t> live_bytes = 0;
+static std::atomic<size_t> allocation_count = 0;
+static constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+void* operator new(size_t size)
+{
+	void* block = std::malloc(size + HeaderSize);
+	if (block == nullptr) throw std::bad_alloc();
+
+	*static_cast<size_t*>(block) = size;
+	live_bytes.fetch_add(size, std::memory_order_relaxed);
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	return static_cast<char*>(block) + HeaderSize;
+}
+
+void operator delete(void* pointer) noexcept
+{
+	if (pointer == nullptr) return;
+	void* block = static_cast<char*>(pointer) - HeaderSize;
+	live_bytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+	std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+namespace rw
+{
+
+/**
+ * A circuit built by a generator, with the wires that are toggled between rounds of ticks to keep it active.
+ */
+struct Circuit
+{
+	std::unique_ptr<Layer> layer = std::make_unique<Layer>();
+	std::vector<Index> inputs;
+};
+
+struct Generator
+{
+	const char* name;
+	Circuit (* build)(uint32_t gate_count, std::mt19937& random);
+};
+
+/**
+ * An edit whose time and allocations are measured, on a circuit that is prepared without being measured.
+ */
+struct Edit
+{
+	const char* name;
+	Circuit (* prepare)(uint32_t tile_count, std::mt19937& random);
+	void (* perform)(Layer& layer, uint32_t tile_count);
+};
+
+struct Options
+{
+	std::vector<std::string> suites;
+	std::vector<std::string> circuits;
+	std::vector<std::string> edits;
+	std::vector<Engine::Mode> modes;
+
+	uint32_t min_count = 1000;
+	uint32_t max_count = 1000000;
+	uint32_t max_tile_count = 100000;
+	double seconds = 1.0;
+	uint32_t thread_count = Engine::get_default_thread_count();
+	uint32_t seed = 42;
+};
+
+static constexpr std::string_view TransistorSymbols = ">v<^";
+static constexpr std::string_view InverterSymbols = "ESWN";
+static constexpr uint32_t RoundTicks = 16; //The number of ticks between two toggles of the circuit inputs
+static constexpr uint32_t EditRepeatLimit = 64; //The maximum number of times each edit is measured
+
+/**
+ * Inserts the tiles drawn in a pattern, where each string is a row of tiles along +x and successive rows go along +y.
+ * A '#' is a wire and a '+' is a bridge. The arrows '>', 'v', '<' and '^' are transistors facing +x, +y, -x and -y,
+ * and the letters 'E', 'S', 'W' and 'N' are inverters facing the same directions. Any other character is left empty.
+ */
+static void stamp(Layer& layer, Int2 origin, const std::vector<std::string>& pattern)
+{
+	for (size_t y = 0; y < pattern.size(); ++y)
+	{
+		for (size_t x = 0; x < pattern[y].size(); ++x)
+		{
+			Int2 position = origin + Int2(static_cast<int32_t>(x), static_cast<int32_t>(y));
+			if (pattern[y][x] == '#') Wire::insert(layer, position);
+			else if (pattern[y][x] == '+') Bridge::insert(layer, position);
+		}
+	}
+
+	//Gates are inserted last so each of them only connects once to its finished neighboring wires
+	for (size_t y = 0; y < pattern.size(); ++y)
+	{
+		for (size_t x = 0; x < pattern[y].size(); ++x)
+		{
+			Int2 position = origin + Int2(static_cast<int32_t>(x), static_cast<int32_t>(y));
+			size_t transistor = TransistorSymbols.find(pattern[y][x]);
+			size_t inverter = InverterSymbols.find(pattern[y][x]);
+
+			if (transistor != std::string_view::npos)
+			{
+				auto rotation = static_cast<TileRotation::Value>(transistor);
+				Gate::insert(layer, position, Gate::Type::Transistor, rotation);
+			}
+			else if (inverter != std::string_view::npos)
+			{
+				auto rotation = static_cast<TileRotation::Value>(inverter);
+				Gate::insert(layer, position, Gate::Type::Inverter, rotation);
+			}
+		}
+	}
+}
+
+/**
+ * Finds the origin of a block out of count blocks with the same size, arranged in a grid that is roughly square.
+ */
+static Int2 arrange(uint32_t index, uint32_t count, Int2 size)
+{
+	double ratio = static_cast<double>(size.y) / size.x;
+	auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(count * ratio)));
+	columns = std::clamp(columns, 1u, count);
+	return Int2(index % columns, index / columns) * size;
+}
+
+static Index get_wire(const Layer& layer, Int2 position)
+{
+	TileTag tile = layer.get(position);
+	assert(tile.type == TileType::Wire);
+	return tile.index;
+}
+
+/**
+ * Ripple-carry adders of 64 bits, each bit is a full adder of two XOR inverters, two AND transistors and a wired OR.
+ * The carry flows along +y through a bridge in each bit, and the two operands of every bit are the inputs.
+ */
+static Circuit build_adders(uint32_t gate_count, std::mt19937&)
+{
+	static constexpr uint32_t BitCount = 64;
+	static const std::vector<std::string> Pattern = {
+		"...###...#",
+		"###W.>##.#",
+		"#..###.#.#",
+		"#.#....#.#",
+		"#.#....#.#",
+		"##N#...#.#",
+		"##.####+##",
+		".#v#...#..",
+		"..#....#..",
+		"..########",
+		".........#"
+	};
+
+	Circuit circuit;
+	uint32_t count = std::max(gate_count / (BitCount * 4), 1u);
+	Int2 size(11, static_cast<int32_t>(BitCount * Pattern.size()) + 1);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Int2 origin = arrange(i, count, size);
+
+		for (uint32_t j = 0; j < BitCount; ++j)
+		{
+			Int2 corner = origin + Int2(0, static_cast<int32_t>(j * Pattern.size()));
+			stamp(*circuit.layer, corner, Pattern);
+			circuit.inputs.push_back(get_wire(*circuit.layer, corner + Int2(3, 0)));
+			circuit.inputs.push_back(get_wire(*circuit.layer, corner + Int2(3, 2)));
+		}
+	}
+
+	return circuit;
+}
+
+/**
+ * Binary counters of 32 bits, each bit is an XOR inverter feeding back into itself and an AND transistor for the carry.
+ * The carry into the lowest bit is always strong powered, so the counters count every tick without any input.
+ */
+static Circuit build_counters(uint32_t gate_count, std::mt19937&)
+{
+	static constexpr uint32_t BitCount = 32;
+	static const std::vector<std::string> Pattern = {
+		".##.",
+		".E##",
+		"##.>",
+		".###"
+	};
+
+	Circuit circuit;
+	uint32_t count = std::max(gate_count / (BitCount * 2), 1u);
+	Int2 size(static_cast<int32_t>(BitCount * 4) + 1, 5);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Int2 origin = arrange(i, count, size);
+		for (uint32_t j = 0; j < BitCount; ++j) stamp(*circuit.layer, origin + Int2(static_cast<int32_t>(j * 4), 0), Pattern);
+	}
+
+	Engine& engine = circuit.layer->get_engine();
+	for (uint32_t i = 0; i < count; ++i) engine.toggle_wire_strong_powered(get_wire(*circuit.layer, arrange(i, count, size) + Int2(0, 2)));
+
+	return circuit;
+}
+
+/**
+ * Shift registers of 64 stages closed into rings by an inverter (Johnson counters), so each ring keeps shifting forever.
+ */
+static Circuit build_shifters(uint32_t gate_count, std::mt19937&)
+{
+	static constexpr uint32_t StageCount = 31; //The number of stages along each side of a ring
+
+	std::string top(StageCount * 2 + 1, '#');
+	std::string middle(StageCount * 2 + 1, '.');
+	std::string bottom(StageCount * 2 + 1, '#');
+
+	for (uint32_t i = 1; i < top.size(); i += 2)
+	{
+		top[i] = '>';
+		bottom[i] = '<';
+	}
+
+	top[1] = 'E';
+	middle.front() = '^';
+	middle.back() = 'v';
+	const std::vector<std::string> pattern = { top, middle, bottom };
+
+	Circuit circuit;
+	uint32_t count = std::max(gate_count / (StageCount * 2 + 2), 1u);
+	Int2 size(static_cast<int32_t>(top.size()) + 1, 4);
+
+	for (uint32_t i = 0; i < count; ++i) stamp(*circuit.layer, arrange(i, count, size), pattern);
+	return circuit;
+}
+
+//A single latch of the memory circuit, its set line runs along the top and its reset line along the left
+static const std::vector<std::string> MemoryPattern = {
+	"+####",
+	"#.v..",
+	"#.##.",
+	"#.NS.",
+	"#>##.",
+	"#...."
+};
+
+/**
+ * A square array of SR latches, each latch is a pair of cross coupled inverters set and reset by two transistors.
+ * Every row of latches shares a set line and every column shares a reset line that crosses the set lines through bridges.
+ */
+static Circuit build_memory(uint32_t gate_count, std::mt19937&)
+{
+	Circuit circuit;
+	auto side = static_cast<uint32_t>(std::ceil(std::sqrt(gate_count / 4.0)));
+	Int2 size(5, 6);
+
+	for (uint32_t y = 0; y < side; ++y)
+	{
+		for (uint32_t x = 0; x < side; ++x) stamp(*circuit.layer, Int2(x, y) * size, MemoryPattern);
+	}
+
+	for (uint32_t i = 0; i < side; ++i)
+	{
+		circuit.inputs.push_back(get_wire(*circuit.layer, Int2(0, i) * size + Int2(1, 0)));
+		circuit.inputs.push_back(get_wire(*circuit.layer, Int2(i, 0) * size + Int2(0, 1)));
+	}
+
+	return circuit;
+}
+
+/**
+ * A square region where every tile is randomly a wire, a gate of random type and rotation, or empty.
+ * The wires clump into randomly shaped nets of different sizes, which are sparsely connected by the gates.
+ */
+static Circuit build_random(uint32_t gate_count, std::mt19937& random)
+{
+	static constexpr double GateDensity = 0.2;
+	static constexpr double WireDensity = 0.45;
+	static constexpr uint32_t InputInterval = 64; //One in this many wire tiles is picked as an input
+
+	Circuit circuit;
+	auto side = static_cast<int32_t>(std::ceil(std::sqrt(gate_count / GateDensity)));
+	std::vector<std::string> pattern(side, std::string(side, '.'));
+	std::uniform_real_distribution<double> distribution;
+	std::vector<Int2> inputs;
+
+	for (int32_t y = 0; y < side; ++y)
+	{
+		for (int32_t x = 0; x < side; ++x)
+		{
+			double value = distribution(random);
+			char& symbol = pattern[y][x];
+
+			if (value < GateDensity)
+			{
+				auto symbols = random() % 2 == 0 ? TransistorSymbols : InverterSymbols;
+				symbol = symbols[random() % symbols.size()];
+			}
+			else if (value < GateDensity + WireDensity)
+			{
+				symbol = '#';
+				if (random() % InputInterval == 0) inputs.emplace_back(x, y);
+			}
+		}
+	}
+
+	stamp(*circuit.layer, Int2(0), pattern);
+	for (Int2 position : inputs) circuit.inputs.push_back(get_wire(*circuit.layer, position));
+	return circuit;
+}
+
+static constexpr std::array<Generator, 5> Generators = {
+	Generator{ "adder", build_adders },
+	Generator{ "counter", build_counters },
+	Generator{ "shift", build_shifters },
+	Generator{ "memory", build_memory },
+	Generator{ "random", build_random }
+};
+
+static void draw_line(Layer& layer, Int2 origin, uint32_t length)
+{
+	for (uint32_t i = 0; i < length; ++i) Wire::insert(layer, origin + Int2(static_cast<int32_t>(i), 0));
+}
+
+static Circuit prepare_empty(uint32_t, std::mt19937&)
+{
+	return {};
+}
+
+static Circuit prepare_line(uint32_t tile_count, std::mt19937&)
+{
+	Circuit circuit;
+	draw_line(*circuit.layer, Int2(0), tile_count);
+	return circuit;
+}
+
+static Circuit prepare_cut_line(uint32_t tile_count, std::mt19937& random)
+{
+	Circuit circuit = prepare_line(tile_count, random);
+	Wire::erase(*circuit.layer, Int2(static_cast<int32_t>(tile_count / 2), 0));
+	return circuit;
+}
+
+static Circuit prepare_ladder(uint32_t tile_count, std::mt19937&)
+{
+	//Two rows joined along their whole length, so cutting a tile out of one row keeps the wire connected
+	Circuit circuit;
+	draw_line(*circuit.layer, Int2(0), tile_count / 2);
+	draw_line(*circuit.layer, Int2(0, 1), tile_count / 2);
+	return circuit;
+}
+
+static Circuit prepare_buses(uint32_t tile_count, std::mt19937&)
+{
+	Circuit circuit;
+	draw_line(*circuit.layer, Int2(0), tile_count / 2);
+	draw_line(*circuit.layer, Int2(static_cast<int32_t>(tile_count / 2) + 1, 0), tile_count / 2);
+	return circuit;
+}
+
+static Circuit prepare_bridged_buses(uint32_t tile_count, std::mt19937& random)
+{
+	Circuit circuit = prepare_buses(tile_count, random);
+	Bridge::insert(*circuit.layer, Int2(static_cast<int32_t>(tile_count / 2), 0));
+	return circuit;
+}
+
+static Circuit prepare_region(uint32_t tile_count, std::mt19937& random)
+{
+	//The random circuit fills about five tiles for each gate
+	return build_random(tile_count / 5, random);
+}
+
+static Circuit prepare_cell(uint32_t, std::mt19937&)
+{
+	Circuit circuit;
+	stamp(*circuit.layer, Int2(0), MemoryPattern);
+	return circuit;
+}
+
+static void perform_draw(Layer& layer, uint32_t tile_count)
+{
+	draw_line(layer, Int2(0), tile_count);
+}
+
+static void perform_line(Layer& layer, uint32_t tile_count)
+{
+	Wire::insert_line(layer, Int2(0), Int2(static_cast<int32_t>(tile_count) - 1, 0), false);
+}
+
+static void perform_cut(Layer& layer, uint32_t tile_count)
+{
+	Wire::erase(layer, Int2(static_cast<int32_t>(tile_count / 2), 0));
+}
+
+static void perform_trim(Layer& layer, uint32_t)
+{
+	Wire::erase(layer, Int2(2, 0));
+}
+
+static void perform_notch(Layer& layer, uint32_t tile_count)
+{
+	Wire::erase(layer, Int2(static_cast<int32_t>(tile_count / 4), 0));
+}
+
+static void perform_join(Layer& layer, uint32_t tile_count)
+{
+	Wire::insert(layer, Int2(static_cast<int32_t>(tile_count / 2), 0));
+}
+
+static void perform_bridge(Layer& layer, uint32_t tile_count)
+{
+	Bridge::insert(layer, Int2(static_cast<int32_t>(tile_count / 2), 0));
+}
+
+static void perform_unbridge(Layer& layer, uint32_t tile_count)
+{
+	Bridge::erase(layer, Int2(static_cast<int32_t>(tile_count / 2), 0));
+}
+
+static void perform_erase(Layer& layer, uint32_t tile_count)
+{
+	//Erases the center quarter of the random region, which splits many of the nets crossing its border
+	auto side = static_cast<int32_t>(std::ceil(std::sqrt(static_cast<double>(tile_count))));
+	layer.erase(Bounds(Int2(side / 4), Int2(side / 4 + side / 2)));
+}
+
+static void perform_paste(Layer& layer, uint32_t tile_count)
+{
+	//Pastes a row of copies of the latch next to it, about thirty tiles for each copy
+	Bounds bounds(Int2(0), Int2(5, 6));
+	Layer cell = layer.copy(bounds);
+
+	std::vector<Int2> positions;
+	for (uint32_t i = 1; i <= tile_count / 30; ++i) positions.emplace_back(static_cast<int32_t>(i * 5), 0);
+	layer.paste(cell, bounds, TileRotation::Angle0, positions);
+}
+
+static void perform_copy(Layer& layer, uint32_t tile_count)
+{
+	//Copies a small selection from the middle of the random region, like the clipboard tool
+	auto side = static_cast<int32_t>(std::ceil(std::sqrt(static_cast<double>(tile_count))));
+	Layer copied = layer.copy(Bounds(Int2(side / 2), Int2(side / 2 + 8)));
+}
+
+static constexpr std::array<Edit, 11> Edits = {
+	Edit{ "draw", prepare_empty, perform_draw },                //Draws a straight wire one tile at a time
+	Edit{ "line", prepare_empty, perform_line },                //Draws the same straight wire all at once
+	Edit{ "cut", prepare_line, perform_cut },                   //Splits a straight wire in the middle
+	Edit{ "trim", prepare_line, perform_trim },                 //Splits two tiles off the end of a straight wire
+	Edit{ "notch", prepare_ladder, perform_notch },             //Erases a tile from a wire that stays connected around it
+	Edit{ "join", prepare_cut_line, perform_join },             //Merges two halves of a straight wire
+	Edit{ "bridge", prepare_buses, perform_bridge },            //Merges two long buses with a bridge
+	Edit{ "unbridge", prepare_bridged_buses, perform_unbridge }, //Splits two long buses joined by a bridge
+	Edit{ "erase", prepare_region, perform_erase },             //Erases a large region of a random circuit
+	Edit{ "paste", prepare_cell, perform_paste },               //Pastes a row of memory latches all at once
+	Edit{ "copy", prepare_region, perform_copy }                //Copies a small selection of a random circuit
+};
+
+static void print_usage()
+{
+	std::cout << "Usage: RedWire2.Bench [options]\n"
+	             "  --suite <name>      One of ticks or edits (default both)\n"
+	             "  --circuit <name>    One of adder, counter, shift, memory or random (default all)\n"
+	             "  --mode <mode>       One of sweep, event, parallel or batch (default all)\n"
+	             "  --min <count>       The approximate number of gates of the smallest circuits (default 1000)\n"
+	             "  --max <count>       The approximate number of gates of the largest circuits (default 1000000)\n"
+	             "  --seconds <value>   The minimum time spent measuring each circuit in each mode, or each edit (default 1)\n"
+	             "  --threads <count>   The number of threads used by the parallel mode\n"
+	             "  --seed <value>      The seed of the random circuits and inputs (default 42)\n"
+	             "  --edit <name>       One of draw, line, cut, trim, notch, join, bridge, unbridge, erase, paste or copy (default all)\n"
+	             "  --tiles <count>     The number of tiles of the largest edits (default 100000)\n"
+	             "Circuits are built at every power of ten between the smallest and largest number of gates.\n"
+	             "The full sweep up to 10000000 gates needs --max 10000000 and several gigabytes of memory for the layers.\n"
+	             "Between every " << RoundTicks << " ticks, an eighth of the inputs of each circuit are toggled.\n"
+	             "Edits are performed on every power of ten from 1000 tiles to the largest number of tiles.\n";
+}
+
+static uint32_t parse_count(std::string_view text)
+{
+	size_t end;
+	unsigned long value = std::stoul(std::string(text), &end);
+	if (end != text.size() || value > std::numeric_limits<uint32_t>::max()) throw std::invalid_argument("Invalid count.");
+	return static_cast<uint32_t>(value);
+}
+
+static Engine::Mode parse_mode(std::string_view text)
+{
+	if (text == "sweep") return Engine::Mode::Sweep;
+	if (text == "event") return Engine::Mode::Event;
+	if (text == "parallel") return Engine::Mode::Parallel;
+	if (text == "batch") return Engine::Mode::Batch;
+	throw std::invalid_argument("Unrecognized mode.");
+}
+
+static const char* to_string(Engine::Mode mode)
+{
+	static constexpr std::array<const char*, 4> Strings = { "Sweep", "Event", "Parallel", "Batch" };
+	return Strings[static_cast<size_t>(mode)];
+}
+
+static Options parse_options(int argc, char** argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view argument = argv[i];
+
+		auto next = [&]() -> std::string_view
+		{
+			if (i + 1 >= argc) throw std::invalid_argument("Missing value after " + std::string(argument) + ".");
+			return argv[++i];
+		};
+
+		if (argument == "--suite")
+		{
+			std::string_view name = next();
+			if (name != "ticks" && name != "edits") throw std::invalid_argument("Unrecognized suite.");
+			options.suites.emplace_back(name);
+		}
+		else if (argument == "--circuit")
+		{
+			std::string_view name = next();
+			auto predicate = [name](const Generator& generator) { return name == generator.name; };
+			if (std::none_of(Generators.begin(), Generators.end(), predicate)) throw std::invalid_argument("Unrecognized circuit.");
+			options.circuits.emplace_back(name);
+		}
+		else if (argument == "--mode") options.modes.push_back(parse_mode(next()));
+		else if (argument == "--min") options.min_count = std::max(parse_count(next()), 1u);
+		else if (argument == "--max") options.max_count = parse_count(next());
+		else if (argument == "--seconds") options.seconds = std::stod(std::string(next()));
+		else if (argument == "--threads") options.thread_count = parse_count(next());
+		else if (argument == "--seed") options.seed = parse_count(next());
+		else if (argument == "--edit")
+		{
+			std::string_view name = next();
+			auto predicate = [name](const Edit& edit) { return name == edit.name; };
+			if (std::none_of(Edits.begin(), Edits.end(), predicate)) throw std::invalid_argument("Unrecognized edit.");
+			options.edits.emplace_back(name);
+		}
+		else if (argument == "--tiles") options.max_tile_count = parse_count(next());
+		else throw std::invalid_argument("Unrecognized argument " + std::string(argument) + ".");
+	}
+
+	if (options.suites.empty()) options.suites = { "ticks", "edits" };
+	if (options.modes.empty()) options.modes = { Engine::Mode::Sweep, Engine::Mode::Event, Engine::Mode::Parallel, Engine::Mode::Batch };
+	return options;
+}
+
+/**
+ * Measures the heap used by an Engine in a mode, after its kernel is compiled by the first tick.
+ * The Engine is measured as a fresh copy, so the memory of the Layer it belongs to is excluded.
+ */
+static size_t measure_engine(const Engine& engine, Engine::Mode mode)
+{
+	auto stream = std::make_shared<std::stringstream>();
+	BinaryWriter writer(stream);
+	writer << engine;
+
+	BinaryReader reader(stream);
+	size_t start = live_bytes.load();
+
+	{
+		Engine copy;
+		reader >> copy;
+		copy.set_mode(mode);
+		copy.tick();
+		return live_bytes.load() - start;
+	}
+}
+
+static void run_circuit(const Options& options, const Generator& generator, uint32_t gate_count)
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::mt19937 random(options.seed);
+	size_t start = live_bytes.load();
+	Circuit circuit = generator.build(gate_count, random);
+
+	Layer& layer = *circuit.layer;
+	Engine& engine = layer.get_engine();
+	size_t layer_bytes = live_bytes.load() - start;
+
+	size_t gates = layer.get_list<Gate>().size();
+	size_t wires = layer.get_list<Wire>().size();
+	auto per_gate = [gates](double value) { return value / static_cast<double>(std::max(gates, size_t(1))); };
+
+	engine.set_thread_count(options.thread_count);
+
+	for (Engine::Mode mode : options.modes)
+	{
+		engine.set_mode(mode);
+		engine.tick(); //The first tick in a mode compiles its kernel
+
+		uint64_t ticks = 0;
+		Clock::duration elapsed{};
+
+		while (ticks == 0 || std::chrono::duration<double>(elapsed).count() < options.seconds)
+		{
+			for (size_t i = 0; i < (circuit.inputs.size() + 7) / 8; ++i)
+			{
+				engine.toggle_wire_strong_powered(circuit.inputs[random() % circuit.inputs.size()]);
+			}
+
+			auto begin = Clock::now();
+			engine.tick(RoundTicks);
+			elapsed += Clock::now() - begin;
+			ticks += RoundTicks;
+		}
+
+		double seconds = std::chrono::duration<double>(elapsed).count();
+		double rate = static_cast<double>(ticks) / seconds;
+		size_t engine_bytes = measure_engine(engine, mode);
+
+		std::cout << std::left << std::setw(10) << generator.name << std::right
+		          << std::setw(10) << gates << std::setw(10) << wires << "  "
+		          << std::left << std::setw(10) << to_string(mode) << std::right
+		          << std::setw(14) << static_cast<uint64_t>(rate)
+		          << std::setw(14) << std::fixed << std::setprecision(3) << per_gate(seconds * 1E9 / static_cast<double>(ticks))
+		          << std::setw(14) << std::setprecision(1) << per_gate(static_cast<double>(layer_bytes))
+		          << std::setw(14) << per_gate(static_cast<double>(engine_bytes)) << std::defaultfloat << std::endl;
+	}
+}
+
+static void run_edit(const Options& options, const Edit& edit, uint32_t tile_count)
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::mt19937 random(options.seed);
+	Clock::duration elapsed{};
+	size_t allocations = 0;
+	uint32_t repeats = 0;
+
+	//Each edit is measured again on a newly prepared circuit until enough time is spent
+	while (repeats == 0 || (std::chrono::duration<double>(elapsed).count() < options.seconds && repeats < EditRepeatLimit))
+	{
+		Circuit circuit = edit.prepare(tile_count, random);
+		size_t start = allocation_count.load();
+		auto begin = Clock::now();
+
+		edit.perform(*circuit.layer, tile_count);
+
+		elapsed += Clock::now() - begin;
+		allocations += allocation_count.load() - start;
+		++repeats;
+	}
+
+	double microseconds = std::chrono::duration<double, std::micro>(elapsed).count() / repeats;
+
+	std::cout << std::left << std::setw(10) << edit.name << std::right << std::setw(10) << tile_count
+	          << std::setw(14) << std::fixed << std::setprecision(1) << microseconds << std::defaultfloat
+	          << std::setw(14) << allocations / repeats << '\n';
+}
+
+static void run_ticks(const Options& options)
+{
+	std::cout << std::left << std::setw(10) << "Circuit" << std::right << std::setw(10) << "Gates" << std::setw(10) << "Wires" << "  "
+	          << std::left << std::setw(10) << "Mode" << std::right << std::setw(14) << "Ticks/Second"
+	          << std::setw(14) << "ns/Gate/Tick" << std::setw(14) << "Layer B/Gate" << std::setw(14) << "Engine B/Gate" << '\n';
+
+	for (const Generator& generator : Generators)
+	{
+		auto& circuits = options.circuits;
+		if (not circuits.empty() && std::find(circuits.begin(), circuits.end(), generator.name) == circuits.end()) continue;
+
+		for (uint64_t count = options.min_count; count <= options.max_count; count *= 10)
+		{
+			run_circuit(options, generator, static_cast<uint32_t>(count));
+		}
+	}
+}
+
+static void run_edits(const Options& options)
+{
+	std::cout << std::left << std::setw(10) << "Edit" << std::right << std::setw(10) << "Tiles"
+	          << std::setw(14) << "Microseconds" << std::setw(14) << "Allocations" << '\n';
+
+	for (const Edit& edit : Edits)
+	{
+		auto& edits = options.edits;
+		if (not edits.empty() && std::find(edits.begin(), edits.end(), edit.name) == edits.end()) continue;
+
+		for (uint64_t count = 1000; count <= options.max_tile_count; count *= 10)
+		{
+			run_edit(options, edit, static_cast<uint32_t>(count));
+		}
+	}
+}
+
+static void run(const Options& options)
+{
+	auto& suites = options.suites;
+	bool ticks = std::find(suites.begin(), suites.end(), "ticks") != suites.end();
+	bool edits = std::find(suites.begin(), suites.end(), "edits") != suites.end();
+
+	if (ticks) run_ticks(options);
+	if (ticks && edits) std::cout << '\n';
+	if (edits) run_edits(options);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (std::string_view(argv[i]) != "--help") continue;
+			rw::print_usage();
+			return 0;
+		}
+
+		rw::run(rw::parse_options(argc, argv));
+		return 0;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << '\n';
+		return 1;
+	}
+}
@@ -0,0 +1,199 @@
+#include "Functional/Board.hpp"
+#include "Functional/Tiles.hpp"
+#include "Functional/Engine.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+namespace rw
+{
+
+struct Options
+{
+	std::string path;
+	std::vector<std::string> toggles;
+	std::vector<std::string> prints;
+
+	uint32_t count = 1;
+	bool settle = false;
+	Engine::Mode mode = Engine::Mode::Sweep;
+	uint32_t thread_count = Engine::get_default_thread_count();
+	bool period_detection = false;
+};
+
+static void print_usage()
+{
+	std::cout << "Usage: RedWire2.Headless <file> [options]\n"
+	             "  --ticks <count>     Perform count ticks (default 1)\n"
+	             "  --settle <count>    Perform ticks until stable, up to count ticks\n"
+	             "  --toggle <wire>     Toggle whether a wire is strong powered before ticking\n"
+	             "  --print <wire>      Print the state of a wire after ticking\n"
+	             "  --mode <mode>       One of sweep, event, parallel or batch (default sweep)\n"
+	             "  --threads <count>   The number of threads used by the parallel mode\n"
+	             "  --period            Detect periods in the states to skip whole periods\n"
+	             "A wire is either its index or the position 'x,y' of one of its tiles.\n";
+}
+
+static uint32_t parse_count(std::string_view text)
+{
+	size_t end;
+	unsigned long value = std::stoul(std::string(text), &end);
+	if (end != text.size() || value > std::numeric_limits<uint32_t>::max()) throw std::invalid_argument("Invalid count.");
+	return static_cast<uint32_t>(value);
+}
+
+static Engine::Mode parse_mode(std::string_view text)
+{
+	if (text == "sweep") return Engine::Mode::Sweep;
+	if (text == "event") return Engine::Mode::Event;
+	if (text == "parallel") return Engine::Mode::Parallel;
+	if (text == "batch") return Engine::Mode::Batch;
+	throw std::invalid_argument("Unrecognized mode.");
+}
+
+static Options parse_options(int argc, char** argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view argument = argv[i];
+
+		auto next = [&]() -> std::string_view
+		{
+			if (i + 1 >= argc) throw std::invalid_argument("Missing value after " + std::string(argument) + ".");
+			return argv[++i];
+		};
+
+		if (argument == "--ticks") options.count = parse_count(next());
+		else if (argument == "--settle")
+		{
+			options.count = parse_count(next());
+			options.settle = true;
+		}
+		else if (argument == "--toggle") options.toggles.emplace_back(next());
+		else if (argument == "--print") options.prints.emplace_back(next());
+		else if (argument == "--mode") options.mode = parse_mode(next());
+		else if (argument == "--threads") options.thread_count = parse_count(next());
+		else if (argument == "--period") options.period_detection = true;
+		else if (options.path.empty() && not argument.starts_with("--")) options.path = argument;
+		else throw std::invalid_argument("Unrecognized argument " + std::string(argument) + ".");
+	}
+
+	if (options.path.empty()) throw std::invalid_argument("Missing file.");
+	return options;
+}
+
+static std::unique_ptr<Layer> load_layer(const std::string& path)
+{
+	auto stream = std::make_shared<std::ifstream>(path, std::ios::binary);
+	if (not stream->good()) throw std::runtime_error("Unable to open stream.");
+
+	BinaryReader reader(stream);
+	uint32_t version;
+	reader >> version;
+	if (version < Layer::OldestFileVersion || version > Layer::FileVersion) throw std::runtime_error("Unrecognized version.");
+
+	//Only the layer is read, the view stored after it is irrelevant without a window
+	auto layer = std::make_unique<Layer>();
+	layer->read(reader, version);
+	return layer;
+}
+
+static Index find_wire(const Layer& layer, std::string_view text)
+{
+	size_t comma = text.find(',');
+	Index index;
+
+	if (comma == std::string_view::npos) index = Index(parse_count(text));
+	else
+	{
+		Int2 position(std::stoi(std::string(text.substr(0, comma))), std::stoi(std::string(text.substr(comma + 1))));
+		TileTag tile = layer.get(position);
+		if (tile.type == TileType::Wire) index = tile.index;
+	}
+
+	if (not index.valid() || not layer.get_list<Wire>().contains(index))
+	{
+		throw std::invalid_argument("No wire at " + std::string(text) + ".");
+	}
+
+	return index;
+}
+
+static void run(const Options& options)
+{
+	std::unique_ptr<Layer> layer = load_layer(options.path);
+	Engine& engine = layer->get_engine();
+
+	engine.set_mode(options.mode);
+	engine.set_thread_count(options.thread_count);
+	engine.set_period_detection(options.period_detection);
+
+	for (const std::string& toggle : options.toggles) engine.toggle_wire_strong_powered(find_wire(*layer, toggle));
+
+	std::vector<Index> prints;
+	for (const std::string& print : options.prints) prints.push_back(find_wire(*layer, print));
+
+	std::cout << "Wires: " << layer->get_list<Wire>().size() << '\n';
+	std::cout << "Gates: " << layer->get_list<Gate>().size() << '\n';
+
+	using Clock = std::chrono::steady_clock;
+	auto start = Clock::now();
+
+	uint32_t performed = options.count;
+	if (options.settle) performed = engine.settle(options.count);
+	else engine.tick(options.count);
+
+	std::chrono::duration<double> elapsed = Clock::now() - start;
+	double rate = static_cast<double>(performed) / std::max(elapsed.count(), 1E-9);
+
+	std::cout << "Ticks: " << performed << '\n';
+	std::cout << "Seconds: " << elapsed.count() << '\n';
+	std::cout << "TPS: " << static_cast<uint64_t>(rate);
+
+	//The ticks in skipped periods are counted without being simulated
+	if (options.period_detection) std::cout << " (Including Skipped Ticks)";
+	std::cout << '\n';
+
+	if (options.settle)
+	{
+		//Zero ticks never confirm that the states are stable
+		if (performed > 0 && engine.is_stable()) std::cout << "Settle Depth: " << performed - 1 << '\n';
+		else std::cout << "Settle Depth: Not Settled\n";
+	}
+
+	if (options.period_detection) std::cout << "Period: " << engine.get_period() << '\n';
+
+	for (size_t i = 0; i < prints.size(); ++i)
+	{
+		uint8_t state = engine.get_state(prints[i]);
+		const char* name = state & 2 ? "Strong" : (state & 1 ? "Powered" : "Unpowered");
+		std::cout << "Wire " << options.prints[i] << ": " << name << '\n';
+	}
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		rw::print_usage();
+		return 1;
+	}
+
+	try
+	{
+		rw::run(rw::parse_options(argc, argv));
+		return 0;
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << exception.what() << '\n';
+		return 1;
+	}
+}
@@ -0,0 +1,553 @@
+#include "main.hpp"
+#include "Functional/Board.hpp"
+#include "Functional/Tiles.hpp"
+#include "Functional/Engine.hpp"
+
+#include "gtest/gtest.h"
+
+#include <array>
+#include <random>
+#include <sstream>
+#include <optional>
+
+using namespace rw;
+
+/**
+ * Builds random layers through the tile APIs and ticks them with every engine configuration next to an independent Model,
+ * comparing the state of every wire after every tick. A failing sequence of steps is shrunk to a minimal repro.
+ * Separately, a Mode::Batch layer with lanes toggled independently is compared against a Model for each of Lanes.
+ */
+class EngineFuzzTests : public testing::Test
+{
+protected:
+	struct Step
+	{
+		enum class Kind : uint8_t
+		{
+			Insert,
+			Erase,
+			Toggle,
+			ToggleLane, //Toggles a wire in one of Lanes only
+			Tick,       //Ticks one tick at a time, comparing after each
+			TickMany,   //Ticks all ticks in one call, which can skip periods
+			Settle      //Settles with the count as the maximum
+		};
+
+		explicit Step(Kind kind = Kind::Tick, Int2 position = Int2()) : kind(kind), position(position) {}
+
+		Kind kind;
+		Int2 position;
+		TileType type;
+		Gate::Type gate_type = Gate::Type::Transistor;
+		TileRotation rotation;
+		uint32_t count = 1;
+		uint32_t lane = 0; //An index into Lanes
+	};
+
+	struct Configuration
+	{
+		const char* name;
+		Engine::Mode mode;
+		bool period_detection;
+		bool vectorized;
+	};
+
+	/**
+	 * A reference with one state byte per wire Index like the original engine, which finds the gates and their wires in the tiles
+	 * of a layer on every tick, so it shares none of the state slots, reordering or kernels of Engine.
+	 */
+	class Model
+	{
+	public:
+		/**
+		 * Copies the states of the wires after an edit, since which wires keep their states through merges and splits is
+		 * decided by the edits and not by the ticks being modeled.
+		 */
+		template<class Getter>
+		void copy_states(const Layer& layer, Getter get_state)
+		{
+			states.clear();
+
+			layer.get_list<Wire>().for_each_index([&](Index index)
+			{
+				if (index >= states.size()) states.resize(index + 1);
+				states[index] = get_state(index);
+			});
+		}
+
+		void toggle(Index index) { states[index] ^= 0b10; }
+
+		/**
+		 * @return Whether the tick changed any state.
+		 */
+		bool tick(const Layer& layer)
+		{
+			std::vector<uint8_t> next(states.size());
+			for (size_t j = 0; j < states.size(); ++j) next[j] = states[j] & 0b10;
+
+			for (Int2 position : Bounds(Int2(0), Int2(RegionSize)))
+			{
+				TileTag tile = layer.get(position);
+				if (tile.type != TileType::Gate) continue;
+
+				//The output is in the direction of the rotation, followed by the inputs in the next rotations
+				const Gate& gate = layer.get_list<Gate>()[tile.index];
+				TileRotation rotation = gate.get_rotation();
+				std::array<Index, 4> wires;
+
+				for (Index& wire : wires)
+				{
+					TileTag neighbor = layer.get(position + rotation.get_direction());
+					if (neighbor.type == TileType::Wire) wire = neighbor.index;
+					rotation = rotation.get_next();
+				}
+
+				if (not wires[0].valid()) continue;
+
+				bool transistor = gate.get_type() == Gate::Type::Transistor;
+				uint8_t powered = 1;
+
+				for (size_t k = 1; k < wires.size(); ++k)
+				{
+					uint8_t state = 1;
+					if (wires[k].valid()) state = states[wires[k]] != 0;
+
+					if (transistor) powered &= state;
+					else powered ^= state;
+				}
+
+				next[wires[0]] |= powered;
+			}
+
+			bool changed = next != states;
+			states = std::move(next);
+			return changed;
+		}
+
+		/**
+		 * Ticks like Engine::settle.
+		 */
+		uint32_t settle(const Layer& layer, uint32_t max_count)
+		{
+			for (uint32_t i = 1; i <= max_count; ++i) if (not tick(layer)) return i;
+			return max_count;
+		}
+
+		[[nodiscard]] std::vector<uint8_t> get_states(const Layer& layer) const
+		{
+			std::vector<uint8_t> result;
+			layer.get_list<Wire>().for_each_index([&](Index index) { result.push_back(states[index]); });
+			return result;
+		}
+
+	private:
+		std::vector<uint8_t> states; //Indexed by wire Index
+	};
+
+	static constexpr uint32_t Seed = 42;
+	static constexpr uint32_t CaseCount = 300;
+	static constexpr int32_t RegionSize = 8;
+
+	static constexpr std::array<Configuration, 9> Configurations = {
+		Configuration{ "Sweep", Engine::Mode::Sweep, false, true }, //The states after edits are copied from this one
+		Configuration{ "Sweep with the scalar kernel", Engine::Mode::Sweep, false, false },
+		Configuration{ "Sweep with period detection", Engine::Mode::Sweep, true, true },
+		Configuration{ "Event", Engine::Mode::Event, false, true },
+		Configuration{ "Event with period detection", Engine::Mode::Event, true, true },
+		Configuration{ "Parallel", Engine::Mode::Parallel, false, true },
+		Configuration{ "Parallel with the scalar kernel", Engine::Mode::Parallel, false, false },
+		Configuration{ "Parallel with period detection", Engine::Mode::Parallel, true, true },
+		Configuration{ "Batch", Engine::Mode::Batch, false, true }
+	};
+
+	static constexpr std::array<uint32_t, 3> Lanes = { 0, 1, 63 };
+
+	static std::vector<Step> generate(std::mt19937& random)
+	{
+		std::vector<Step> steps;
+		auto next_position = [&random] { return Int2(random() % RegionSize, random() % RegionSize); };
+
+		auto next_insert = [&]
+		{
+			Step step{ Step::Kind::Insert, next_position() };
+			uint32_t value = random() % 10;
+
+			if (value < 5) step.type = TileType::Wire;
+			else if (value < 6) step.type = TileType::Bridge;
+			else
+			{
+				step.type = TileType::Gate;
+				step.gate_type = random() % 2 == 0 ? Gate::Type::Transistor : Gate::Type::Inverter;
+				step.rotation = static_cast<TileRotation::Value>(random() % 4);
+			}
+
+			return step;
+		};
+
+		uint32_t insert_count = 20 + random() % 40;
+		for (uint32_t i = 0; i < insert_count; ++i) steps.push_back(next_insert());
+
+		uint32_t step_count = 40 + random() % 80;
+
+		for (uint32_t i = 0; i < step_count; ++i)
+		{
+			uint32_t value = random() % 13;
+
+			if (value < 2) steps.push_back(next_insert());
+			else if (value < 3) steps.push_back(Step{ Step::Kind::Erase, next_position() });
+			else if (value < 5) steps.push_back(Step{ Step::Kind::Toggle, next_position() });
+			else if (value < 6)
+			{
+				Step step{ Step::Kind::ToggleLane, next_position() };
+				step.lane = random() % Lanes.size();
+				steps.push_back(step);
+			}
+			else if (value < 8)
+			{
+				Step step{ value == 6 ? Step::Kind::TickMany : Step::Kind::Settle };
+				step.count = 2 + random() % 40;
+				steps.push_back(step);
+			}
+			else
+			{
+				Step step{ Step::Kind::Tick };
+				step.count = 1 + random() % 4;
+				steps.push_back(step);
+			}
+		}
+
+		return steps;
+	}
+
+	/**
+	 * Applies a step to a layer, steps that no longer apply (because the steps before them were shrunk away) are skipped.
+	 */
+	static void apply(Layer& layer, const Step& step)
+	{
+		TileTag tile = layer.get(step.position);
+
+		switch (step.kind)
+		{
+			case Step::Kind::Insert:
+			{
+				if (tile.type != TileType::None) break;
+				if (step.type == TileType::Wire) Wire::insert(layer, step.position);
+				else if (step.type == TileType::Bridge) Bridge::insert(layer, step.position);
+				else Gate::insert(layer, step.position, step.gate_type, step.rotation);
+				break;
+			}
+			case Step::Kind::Erase:
+			{
+				if (tile.type == TileType::Wire) Wire::erase(layer, step.position);
+				else if (tile.type == TileType::Bridge) Bridge::erase(layer, step.position);
+				else if (tile.type == TileType::Gate) Gate::erase(layer, step.position);
+				break;
+			}
+			case Step::Kind::Toggle:
+			{
+				if (tile.type == TileType::Wire) layer.get_engine().toggle_wire_strong_powered(tile.index);
+				break;
+			}
+			default: break;
+		}
+	}
+
+	/**
+	 * Toggles a wire in one lane of the Mode::Batch layer, and in the model of that lane.
+	 */
+	static void toggle_lane(Layer& lanes, Model& model, const Step& step)
+	{
+		TileTag tile = lanes.get(step.position);
+		if (tile.type != TileType::Wire) return;
+
+		uint64_t powered;
+		uint64_t strong;
+		lanes.get_engine().get_lanes(tile.index, powered, strong);
+		lanes.get_engine().set_strong_lanes(tile.index, strong ^ uint64_t(1) << Lanes[step.lane]);
+		model.toggle(tile.index);
+	}
+
+	static uint8_t get_lane_state(const Layer& layer, Index index, uint32_t lane)
+	{
+		uint64_t powered;
+		uint64_t strong;
+		layer.get_engine().get_lanes(index, powered, strong);
+		return static_cast<uint8_t>((powered >> lane & 1) | (strong >> lane & 1) << 1);
+	}
+
+	static std::vector<uint8_t> get_states(const Layer& layer)
+	{
+		std::vector<uint8_t> states;
+		layer.get_list<Wire>().for_each_index([&](Index index) { states.push_back(layer.get_engine().get_state(index)); });
+		return states;
+	}
+
+	static std::vector<uint8_t> get_lane_states(const Layer& layer, uint32_t lane)
+	{
+		std::vector<uint8_t> states;
+		layer.get_list<Wire>().for_each_index([&](Index index) { states.push_back(get_lane_state(layer, index, lane)); });
+		return states;
+	}
+
+	/**
+	 * Compares every configuration against the model, and every lane of the Mode::Batch layer against the model of that lane.
+	 * @return A description of the first difference, or nothing if there is none.
+	 */
+	static std::optional<std::string> compare(const std::vector<Layer>& layers, const Model& model,
+	                                          const Layer& lanes, const std::array<Model, Lanes.size()>& lane_models, uint32_t tick)
+	{
+		std::vector<uint8_t> reference = model.get_states(layers[0]);
+		std::stringstream stream;
+
+		for (size_t j = 0; j < layers.size(); ++j)
+		{
+			if (get_states(layers[j]) == reference) continue;
+			stream << Configurations[j].name << " differs from the model after tick " << tick;
+			return stream.str();
+		}
+
+		for (size_t j = 0; j < Lanes.size(); ++j)
+		{
+			if (get_lane_states(lanes, Lanes[j]) == lane_models[j].get_states(lanes)) continue;
+			stream << "Batch lane " << Lanes[j] << " differs from the model after tick " << tick;
+			return stream.str();
+		}
+
+		return std::nullopt;
+	}
+
+	/**
+	 * Runs the steps on a layer for every configuration and the model, along with the Mode::Batch layer and the models of its lanes.
+	 * @return A description of the first difference from the models, or nothing if there is none.
+	 */
+	static std::optional<std::string> run(const std::vector<Step>& steps)
+	{
+		std::vector<Layer> layers;
+
+		for (const Configuration& configuration : Configurations)
+		{
+			Engine& engine = layers.emplace_back().get_engine();
+			engine.set_mode(configuration.mode);
+			engine.set_thread_count(3);
+			engine.set_period_detection(configuration.period_detection);
+			engine.set_vectorized(configuration.vectorized);
+		}
+
+		Model model;
+		Layer lanes;
+		lanes.get_engine().set_mode(Engine::Mode::Batch);
+		std::array<Model, Lanes.size()> lane_models;
+
+		auto tick_models = [&]
+		{
+			bool changed = model.tick(layers[0]);
+			for (Model& lane_model : lane_models) lane_model.tick(lanes);
+			return changed;
+		};
+
+		uint32_t tick = 0;
+
+		for (const Step& step : steps)
+		{
+			switch (step.kind)
+			{
+				case Step::Kind::ToggleLane:
+				{
+					toggle_lane(lanes, lane_models[step.lane], step);
+					break;
+				}
+				case Step::Kind::Toggle:
+				{
+					for (Layer& layer : layers) apply(layer, step);
+					apply(lanes, step);
+
+					TileTag tile = lanes.get(step.position);
+					if (tile.type != TileType::Wire) break;
+
+					model.toggle(tile.index);
+					for (Model& lane_model : lane_models) lane_model.toggle(tile.index);
+					break;
+				}
+				case Step::Kind::Tick:
+				{
+					for (uint32_t i = 0; i < step.count; ++i, ++tick)
+					{
+						for (Layer& layer : layers) layer.get_engine().tick();
+						lanes.get_engine().tick();
+						tick_models();
+
+						if (auto difference = compare(layers, model, lanes, lane_models, tick)) return difference;
+					}
+
+					break;
+				}
+				case Step::Kind::TickMany:
+				{
+					for (Layer& layer : layers) layer.get_engine().tick(step.count);
+					lanes.get_engine().tick(step.count);
+					for (uint32_t i = 0; i < step.count; ++i) tick_models();
+					tick += step.count;
+
+					if (auto difference = compare(layers, model, lanes, lane_models, tick)) return difference;
+					break;
+				}
+				case Step::Kind::Settle:
+				{
+					uint32_t performed = model.settle(layers[0], step.count);
+					std::stringstream stream;
+
+					for (size_t j = 0; j < layers.size(); ++j)
+					{
+						uint32_t other = layers[j].get_engine().settle(step.count);
+						if (other == performed) continue;
+
+						stream << Configurations[j].name << " settled in " << other << " ticks instead of " << performed << " after tick " << tick;
+						return stream.str();
+					}
+
+					//The lanes settle together, so the model of each lane must be stable once all of them are
+					uint32_t lanes_performed = lanes.get_engine().settle(step.count);
+
+					for (size_t j = 0; j < Lanes.size(); ++j)
+					{
+						bool changed = false;
+						for (uint32_t i = 0; i < lanes_performed; ++i) changed = lane_models[j].tick(lanes);
+						if (lanes_performed == step.count || not changed) continue;
+
+						stream << "Batch lane " << Lanes[j] << " is not stable after settling in " << lanes_performed << " ticks after tick " << tick;
+						return stream.str();
+					}
+
+					tick += performed;
+					if (auto difference = compare(layers, model, lanes, lane_models, tick)) return difference;
+					break;
+				}
+				default:
+				{
+					for (Layer& layer : layers) apply(layer, step);
+					apply(lanes, step);
+
+					model.copy_states(layers[0], [&layers](Index index) { return layers[0].get_engine().get_state(index); });
+
+					for (size_t j = 0; j < Lanes.size(); ++j)
+					{
+						lane_models[j].copy_states(lanes, [&lanes, j](Index index) { return get_lane_state(lanes, index, Lanes[j]); });
+					}
+
+					if (auto difference = compare(layers, model, lanes, lane_models, tick)) return difference;
+					break;
+				}
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	/**
+	 * Removes chunks of steps and reduces tick counts for as long as the steps keep failing.
+	 */
+	static std::vector<Step> shrink(std::vector<Step> steps)
+	{
+		bool progress = true;
+
+		while (progress)
+		{
+			progress = false;
+
+			for (size_t size = steps.size() / 2; size > 0; size /= 2)
+			{
+				for (size_t i = 0; i + size <= steps.size();)
+				{
+					std::vector<Step> candidate = steps;
+					candidate.erase(candidate.begin() + static_cast<ptrdiff_t>(i), candidate.begin() + static_cast<ptrdiff_t>(i + size));
+
+					if (run(candidate))
+					{
+						steps = std::move(candidate);
+						progress = true;
+					}
+					else i += size;
+				}
+			}
+
+			for (Step& step : steps)
+			{
+				if (step.count == 1) continue;
+
+				uint32_t count = step.count;
+				step.count = 1;
+
+				if (run(steps)) progress = true;
+				else step.count = count;
+			}
+		}
+
+		return steps;
+	}
+
+	static std::string to_string(const std::vector<Step>& steps)
+	{
+		std::stringstream stream;
+
+		for (const Step& step : steps)
+		{
+			Int2 position = step.position;
+
+			switch (step.kind)
+			{
+				case Step::Kind::Insert:
+				{
+					stream << "Insert " << step.type.to_string();
+					if (step.type == TileType::Gate) stream << " (" << (step.gate_type == Gate::Type::Transistor ? "Transistor" : "Inverter") << ", " << step.rotation.to_string() << ")";
+					stream << " at " << position.x << ", " << position.y << '\n';
+					break;
+				}
+				case Step::Kind::Erase:
+				{
+					stream << "Erase at " << position.x << ", " << position.y << '\n';
+					break;
+				}
+				case Step::Kind::Toggle:
+				{
+					stream << "Toggle at " << position.x << ", " << position.y << '\n';
+					break;
+				}
+				case Step::Kind::ToggleLane:
+				{
+					stream << "Toggle lane " << Lanes[step.lane] << " at " << position.x << ", " << position.y << '\n';
+					break;
+				}
+				case Step::Kind::Tick:
+				{
+					stream << "Tick " << step.count << '\n';
+					break;
+				}
+				case Step::Kind::TickMany:
+				{
+					stream << "Tick " << step.count << " at once\n";
+					break;
+				}
+				case Step::Kind::Settle:
+				{
+					stream << "Settle up to " << step.count << '\n';
+					break;
+				}
+			}
+		}
+
+		return stream.str();
+	}
+};
+
+TEST_F(EngineFuzzTests, Random)
+{
+	for (uint32_t i = 0; i < CaseCount; ++i)
+	{
+		std::mt19937 random(Seed + i);
+		std::vector<Step> steps = generate(random);
+		if (not run(steps)) continue;
+
+		std::vector<Step> shrunk = shrink(steps);
+		FAIL() << "Case " << i << ": " << *run(shrunk) << " with steps:\n" << to_string(shrunk);
+	}
+}
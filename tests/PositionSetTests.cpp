@@ -0,0 +1,149 @@
+#include "Utility/PositionSet.hpp"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <unordered_set>
+
+using namespace rw;
+
+class PositionSetTests : public testing::Test
+{
+protected:
+	void insert(Int2 position)
+	{
+		ASSERT_EQ(set.insert(position), reference.insert(position).second);
+		assert_contents(reference, set);
+	}
+
+	void erase(Int2 position)
+	{
+		ASSERT_EQ(set.erase(position), reference.erase(position) > 0);
+		assert_contents(reference, set);
+	}
+
+	static void assert_contents(const std::unordered_set<Int2>& reference, const PositionSet& set)
+	{
+		ASSERT_EQ(set.size(), reference.size());
+		ASSERT_EQ(set.empty(), reference.empty());
+
+		size_t count = 0;
+
+		for (Int2 position : set)
+		{
+			ASSERT_TRUE(reference.contains(position));
+			++count;
+		}
+
+		ASSERT_EQ(count, reference.size());
+		for (Int2 position : reference) ASSERT_TRUE(set.contains(position));
+	}
+
+	PositionSet set;
+	std::unordered_set<Int2> reference;
+};
+
+TEST_F(PositionSetTests, Simple)
+{
+	insert(Int2(0, 0));
+	insert(Int2(31, 31));
+	insert(Int2(32, 0));
+	insert(Int2(-1, -1));
+	insert(Int2(-32, 5));
+	insert(Int2(0, 0));
+
+	ASSERT_FALSE(set.contains(Int2(1, 0)));
+	ASSERT_FALSE(set.contains(Int2(-33, 5)));
+
+	erase(Int2(31, 31));
+	erase(Int2(31, 31));
+	erase(Int2(-1, -1));
+	erase(Int2(0, 0));
+	erase(Int2(32, 0));
+	erase(Int2(-32, 5));
+}
+
+TEST_F(PositionSetTests, Line)
+{
+	//Spans enough blocks to use the table
+	for (int32_t x = -1000; x < 1000; ++x) insert(Int2(x, x / 3));
+	for (int32_t x = -1000; x < 1000; x += 2) erase(Int2(x, x / 3));
+	for (int32_t x = 999; x >= -1000; --x) erase(Int2(x, x / 3));
+}
+
+TEST_F(PositionSetTests, Random)
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int32_t> distribution(-300, 300);
+
+	for (size_t i = 0; i < 4000; ++i)
+	{
+		Int2 position(distribution(random), distribution(random));
+		if (random() % 3 == 0) erase(position);
+		else insert(position);
+	}
+
+	while (not reference.empty()) erase(*reference.begin());
+}
+
+TEST_F(PositionSetTests, Union)
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int32_t> distribution(-500, 500);
+
+	PositionSet other;
+	std::unordered_set<Int2> other_reference;
+
+	for (size_t i = 0; i < 2000; ++i)
+	{
+		Int2 position(distribution(random), distribution(random));
+		if (i % 2 == 0) insert(position);
+		else ASSERT_EQ(other.insert(position), other_reference.insert(position).second);
+	}
+
+	bool intersects = false;
+	for (Int2 position : other_reference) intersects |= reference.contains(position);
+	ASSERT_EQ(set.intersects(other), intersects);
+	ASSERT_EQ(other.intersects(set), intersects);
+
+	set.insert(other);
+	reference.insert(other_reference.begin(), other_reference.end());
+	assert_contents(reference, set);
+	assert_contents(other_reference, other);
+
+	ASSERT_TRUE(set.intersects(other));
+	set.clear();
+	reference.clear();
+	assert_contents(reference, set);
+	ASSERT_FALSE(set.intersects(other));
+}
+
+TEST_F(PositionSetTests, Difference)
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int32_t> distribution(-100, 100);
+
+	PositionSet other;
+	std::unordered_set<Int2> other_reference;
+
+	for (size_t i = 0; i < 6000; ++i)
+	{
+		Int2 position(distribution(random), distribution(random));
+		if (i % 3 != 0) insert(position);
+		if (i % 2 == 0)
+		{
+			ASSERT_EQ(other.insert(position), other_reference.insert(position).second);
+		}
+	}
+
+	set.erase(other);
+	for (Int2 position : other_reference) reference.erase(position);
+	assert_contents(reference, set);
+	ASSERT_FALSE(set.intersects(other));
+
+	//Erasing a superset removes the emptied blocks
+	other.insert(set);
+	set.erase(other);
+	reference.clear();
+	assert_contents(reference, set);
+}
@@ -3,6 +3,7 @@
 #include "Functional/Tiles.hpp"
 
 #include "gtest/gtest.h"
+#include <random>
 #include <unordered_set>
 
 using namespace rw;
@@ -13,6 +14,7 @@ protected:
 	void SetUp() override
 	{
 		layer = std::make_unique<Layer>();
+		other = std::make_unique<Layer>();
 	}
 
 	void insert_wires(Int2 position, Int2 gap = Int2(), uint32_t count = 1)
@@ -42,9 +44,69 @@ protected:
 		}
 	}
 
+	/**
+	 * Inserts wires and bridges at random positions within size, where one in every bridge_ratio insertions is a bridge.
+	 */
+	void insert_random(std::mt19937& random, Int2 size, uint32_t count, uint32_t bridge_ratio)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			Int2 position(static_cast<int32_t>(random() % size.x), static_cast<int32_t>(random() % size.y));
+			if (random() % bridge_ratio == 0) insert_bridge(position);
+			else insert_wires(position);
+		}
+	}
+
+	/**
+	 * Inserts the wires and bridges of layer within bounds into other one tile at a time.
+	 */
+	void replay_tiles(Bounds bounds)
+	{
+		for (Int2 position : bounds)
+		{
+			TileType type = layer->get(position).type;
+			if (type == TileType::Wire) Wire::insert(*other, position);
+			else if (type == TileType::Bridge) Bridge::insert(*other, position);
+		}
+	}
+
+	/**
+	 * Asserts that layer and other have the same tiles within bounds, with the wire tiles grouped into the same wires.
+	 */
+	void assert_same_wires(Bounds bounds) const
+	{
+		ASSERT_EQ(layer->get_list<Wire>().size(), other->get_list<Wire>().size());
+
+		for (Int2 position : bounds)
+		{
+			TileTag tile = layer->get(position);
+			TileTag other_tile = other->get(position);
+			ASSERT_EQ(tile.type, other_tile.type);
+			if (tile.type != TileType::Wire) continue;
+
+			for (Int2 next : bounds)
+			{
+				if (not layer->has(next, TileType::Wire)) continue;
+				ASSERT_EQ(tile.index == layer->get(next).index, other_tile.index == other->get(next).index);
+			}
+		}
+	}
+
 	std::unique_ptr<Layer> layer;
+	std::unique_ptr<Layer> other; //Edited one tile at a time, to compare against the same edits made to layer at once
+};
+
+/**
+ * Runs each test with a different seed for its random edits.
+ */
+class WireBridgeRandomTests : public WireBridgeTests, public testing::WithParamInterface<uint32_t>
+{
+protected:
+	std::mt19937 random{ GetParam() };
 };
 
+INSTANTIATE_TEST_SUITE_P(Seeds, WireBridgeRandomTests, testing::Range(0u, 20u));
+
 TEST_F(WireBridgeTests, Simple)
 {
 	auto& wires = layer->get_list<Wire>();
@@ -128,3 +190,225 @@ TEST_F(WireBridgeTests, DisconnectBridge)
 	insert_wires(Int2(1, -2));
 	ASSERT_EQ(wires.size(), 1);
 }
+
+TEST_F(WireBridgeTests, Merges)
+{
+	auto& wires = layer->get_list<Wire>();
+
+	insert_wires(Int2(0, 0), Int2(2, 0), 2000);
+	ASSERT_EQ(wires.size(), 2000);
+	insert_wires(Int2(1, 0), Int2(2, 0), 1999);
+	ASSERT_EQ(wires.size(), 1);
+
+	//Splitting registers enough new wires for the merged components to be compacted
+	erase(Int2(3, 0), Int2(4, 0), 999);
+	ASSERT_EQ(wires.size(), 1000);
+	layer->compact();
+
+	for (int32_t x = 0; x < 3999; ++x)
+	{
+		TileTag tile = layer->get(Int2(x, 0));
+		if (x % 4 == 3) ASSERT_EQ(tile.type, TileType::None);
+		else ASSERT_EQ(tile, layer->get(Int2(x - x % 4, 0)));
+
+		if (tile.type == TileType::Wire)
+		{
+			ASSERT_TRUE(wires.contains(tile.index));
+		}
+	}
+}
+
+TEST_F(WireBridgeTests, Line)
+{
+	auto& wires = layer->get_list<Wire>();
+	auto& bridges = layer->get_list<Bridge>();
+
+	insert_wires(Int2(0, -2), Int2(0, 1), 5);
+	insert_wires(Int2(4, -2), Int2(0, 1), 5);
+	ASSERT_EQ(wires.size(), 2);
+
+	Wire::insert_line(*layer, Int2(6, 0), Int2(-2, 0), true);
+	ASSERT_EQ(wires.size(), 3);
+	ASSERT_EQ(bridges.size(), 2);
+	ASSERT_EQ(layer->get(Int2(-2, 0)), layer->get(Int2(6, 0)));
+
+	Wire::insert_line(*layer, Int2(2, -2), Int2(2, 2), false);
+	ASSERT_EQ(wires.size(), 3);
+	ASSERT_EQ(layer->get(Int2(2, -2)), layer->get(Int2(6, 0)));
+
+	Wire::insert_line(*layer, Int2(-2, 2), Int2(6, 2), false);
+	ASSERT_EQ(wires.size(), 1);
+}
+
+TEST_P(WireBridgeRandomTests, LineMatchesTiles)
+{
+	Bounds area(Int2(0), Int2(16));
+	insert_random(random, area.size(), 200, 4);
+	replay_tiles(area);
+
+	for (uint32_t i = 0; i < 20; ++i)
+	{
+		Int2 from(static_cast<int32_t>(random() % 16), static_cast<int32_t>(random() % 16));
+		Int2 to = from;
+		if (i % 2 == 0) to.x = static_cast<int32_t>(random() % 16);
+		else to.y = static_cast<int32_t>(random() % 16);
+		bool auto_bridge = i % 3 == 0;
+
+		Wire::insert_line(*layer, from, to, auto_bridge);
+
+		//The same line one tile at a time, like the wire tool used to
+		Int2 other_axis = from.y == to.y ? Int2(0, 1) : Int2(1, 0);
+
+		for (Int2 current : Bounds(from.min(to), from.max(to) + Int2(1)))
+		{
+			TileType type = other->get(current).type;
+
+			if (auto_bridge && (type == TileType::None || type == TileType::Wire) &&
+			    (other->has(current + other_axis, TileType::Wire) || other->has(current - other_axis, TileType::Wire)))
+			{
+				if (type == TileType::Wire) Wire::erase(*other, current);
+				Bridge::insert(*other, current);
+			}
+			else if (type == TileType::None) Wire::insert(*other, current);
+		}
+
+		ASSERT_NO_FATAL_FAILURE(assert_same_wires(area));
+	}
+}
+
+TEST_P(WireBridgeRandomTests, PasteMatchesTiles)
+{
+	Layer source;
+	Bounds bounds(Int2(-3, 2), Int2(4, 7));
+	TileRotation rotation = static_cast<TileRotation::Value>(GetParam() % 4);
+
+	for (uint32_t i = 0; i < 40; ++i)
+	{
+		Int2 position(static_cast<int32_t>(random() % 10) - 4, static_cast<int32_t>(random() % 8));
+		if (source.get(position).type != TileType::None) continue;
+
+		uint32_t value = random() % 6;
+		if (value < 3) Wire::insert(source, position);
+		else if (value < 4) Bridge::insert(source, position);
+		else Gate::insert(source, position, value == 4 ? Gate::Type::Transistor : Gate::Type::Inverter, static_cast<TileRotation::Value>(random() % 4));
+	}
+
+	//Existing tiles around and between the copies, so the copies both merge and skip tiles
+	insert_random(random, Int2(24, 12), 60, 4);
+	replay_tiles(Bounds(Int2(0), Int2(24, 12)));
+
+	//The copies do not overlap, like those of the clipboard tool
+	std::vector<Int2> positions = { Int2(1, 1), Int2(8, 1), Int2(15, 1), Int2(3, 8) };
+	layer->paste(source, bounds, rotation, positions);
+
+	//The same copies one tile at a time, like the clipboard tool used to
+	Int2 size = bounds.size();
+	if (rotation.vertical()) std::swap(size.x, size.y);
+
+	for (Int2 position : positions)
+	{
+		if (rotation == TileRotation::Angle180 || rotation == TileRotation::Angle90) position.x += size.x - 1;
+		if (rotation == TileRotation::Angle180 || rotation == TileRotation::Angle270) position.y += size.y - 1;
+		Int2 multiplier(rotation == TileRotation::Angle180 || rotation == TileRotation::Angle90 ? -1 : 1,
+		                rotation == TileRotation::Angle180 || rotation == TileRotation::Angle270 ? -1 : 1);
+
+		for (Int2 current : bounds)
+		{
+			TileTag tile = source.get(current);
+			Int2 offset = current - bounds.get_min();
+			if (rotation.vertical()) std::swap(offset.x, offset.y);
+			Int2 target = offset * multiplier + position;
+
+			if (tile.type == TileType::None || not other->has(target, TileType::None)) continue;
+
+			if (tile.type == TileType::Wire) Wire::insert(*other, target);
+			else if (tile.type == TileType::Bridge) Bridge::insert(*other, target);
+			else
+			{
+				const Gate& gate = source.get_list<Gate>()[tile.index];
+				Gate::insert(*other, target, gate.get_type(), rotation.rotate(gate.get_rotation()));
+			}
+		}
+	}
+
+	Bounds area(Int2(0), Int2(24, 16));
+	ASSERT_NO_FATAL_FAILURE(assert_same_wires(area));
+	ASSERT_EQ(layer->get_list<Gate>().size(), other->get_list<Gate>().size());
+
+	for (Int2 position : area)
+	{
+		TileTag tile = layer->get(position);
+		if (tile.type != TileType::Gate) continue;
+
+		const Gate& gate = layer->get_list<Gate>()[tile.index];
+		const Gate& other_gate = other->get_list<Gate>()[other->get(position).index];
+		ASSERT_EQ(gate.get_type(), other_gate.get_type());
+		ASSERT_EQ(gate.get_rotation(), other_gate.get_rotation());
+	}
+}
+
+TEST_P(WireBridgeRandomTests, EraseMatchesTiles)
+{
+	Bounds area(Int2(0), Int2(20));
+	insert_random(random, area.size(), 300, 5);
+	replay_tiles(area);
+
+	Int2 corner(static_cast<int32_t>(random() % 20), static_cast<int32_t>(random() % 20));
+	Bounds bounds = Bounds::encapsulate(corner, Int2(static_cast<int32_t>(random() % 20), static_cast<int32_t>(random() % 20)));
+	layer->erase(bounds);
+
+	//The same region one tile at a time, like the layer used to
+	for (Int2 position : bounds)
+	{
+		TileType type = other->get(position).type;
+		if (type == TileType::Wire) Wire::erase(*other, position);
+		else if (type == TileType::Bridge) Bridge::erase(*other, position);
+	}
+
+	ASSERT_NO_FATAL_FAILURE(assert_same_wires(area));
+	ASSERT_EQ(layer->get_list<Bridge>().size(), other->get_list<Bridge>().size());
+}
+
+TEST_F(WireBridgeTests, CopyIsBounded)
+{
+	//Two long wires crossing at a bridge, with a gate beside the crossing
+	insert_wires(Int2(-500, 0), Int2(1, 0), 1000);
+	insert_wires(Int2(0, -500), Int2(0, 1), 1000);
+	erase(Int2(0, 0));
+	insert_bridge(Int2(0, 0));
+	insert_wires(Int2(100, 100), Int2(1, 0), 100);
+	Gate::insert(*layer, Int2(1, 1), Gate::Type::Inverter, TileRotation::Angle0);
+
+	Bounds bounds(Int2(-1), Int2(2));
+	Layer copied = layer->copy(bounds);
+
+	ASSERT_EQ(copied.get_list<Wire>().size(), 2);
+	ASSERT_EQ(copied.get_list<Bridge>().size(), 1);
+	ASSERT_EQ(copied.get_list<Gate>().size(), 1);
+
+	for (Int2 position : Bounds(Int2(-3), Int2(4)))
+	{
+		TileTag tile = layer->get(position);
+		TileTag copied_tile = copied.get(position);
+
+		if (bounds.contains(position)) ASSERT_EQ(copied_tile.type, tile.type);
+		else ASSERT_EQ(copied_tile.type, TileType::None);
+	}
+
+	//Each copied wire only holds the tiles within the bounds
+	Index horizontal = copied.get(Int2(-1, 0)).index;
+	Index vertical = copied.get(Int2(0, -1)).index;
+	ASSERT_NE(horizontal, vertical);
+	ASSERT_EQ(copied.get(Int2(1, 0)).index, horizontal);
+	ASSERT_EQ(copied.get(Int2(0, 1)).index, vertical);
+	ASSERT_EQ(copied.get_list<Wire>()[horizontal].length(), 2);
+	ASSERT_EQ(copied.get_list<Wire>()[vertical].length(), 2);
+
+	//The copy can be pasted like the original region
+	layer->paste(copied, bounds, TileRotation::Angle0, std::vector<Int2>{ Int2(200) });
+
+	for (Int2 offset : Bounds(Int2(0), bounds.size()))
+	{
+		ASSERT_EQ(layer->get(Int2(200) + offset).type, copied.get(bounds.get_min() + offset).type);
+	}
+}